@@ -0,0 +1,10 @@
+#ifndef __HOST_ESP_ATTR_H__
+#define __HOST_ESP_ATTR_H__
+
+// Placement attributes mean nothing on the host
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define DMA_ATTR
+
+#endif  /* __HOST_ESP_ATTR_H__ */
@@ -0,0 +1,9 @@
+#ifndef __HOST_ESP_CPU_H__
+#define __HOST_ESP_CPU_H__
+
+#include <stdint.h>
+
+// Nanoseconds of real time from clock_gettime, as CPU cycles at 1 GHz. Unlike host time it moves while the CPU works.
+uint32_t esp_cpu_get_cycle_count(void);
+
+#endif  /* __HOST_ESP_CPU_H__ */
@@ -0,0 +1,12 @@
+#ifndef __HOST_ESP_ROM_SYS_H__
+#define __HOST_ESP_ROM_SYS_H__
+
+#include <stdint.h>
+
+// Busy wait, which only moves host time forward
+void esp_rom_delay_us(uint32_t us);
+
+// Cycles of esp_cpu_get_cycle_count a microsecond, 1000 on the host
+uint32_t esp_rom_get_cpu_ticks_per_us(void);
+
+#endif  /* __HOST_ESP_ROM_SYS_H__ */
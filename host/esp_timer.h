@@ -0,0 +1,9 @@
+#ifndef __HOST_ESP_TIMER_H__
+#define __HOST_ESP_TIMER_H__
+
+#include <stdint.h>
+
+// Microseconds of host time, see hostGetTimeNs in idf_host.h
+int64_t esp_timer_get_time(void);
+
+#endif  /* __HOST_ESP_TIMER_H__ */
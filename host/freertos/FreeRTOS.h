@@ -0,0 +1,33 @@
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+// Host stand-in for the parts of ESP-IDF FreeRTOS used by the driver
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include <esp_err.h>
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define portTICK_PERIOD_MS  1
+#define portMAX_DELAY       ((TickType_t) 0xFFFFFFFF)
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+// No interrupts to hold off on the host, so a critical section is just a lock
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux) pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)  pthread_mutex_unlock(mux)
+
+#endif  /* __HOST_FREERTOS_H__ */
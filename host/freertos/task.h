@@ -0,0 +1,24 @@
+#ifndef __HOST_TASK_H__
+#define __HOST_TASK_H__
+
+#include <freertos/FreeRTOS.h>
+
+// Tasks are POSIX threads on the host, and core affinity is ignored. Notification waits use real time, everything else
+// host time.
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void* parameters);
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+void vTaskDelay(const TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWakeTime, const TickType_t timeIncrement);
+TickType_t xTaskGetTickCount(void);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, const uint32_t stackDepth, void* parameters, UBaseType_t priority, TaskHandle_t* createdTask, const BaseType_t coreId);
+void vTaskDelete(TaskHandle_t task);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+#endif  /* __HOST_TASK_H__ */
@@ -0,0 +1,529 @@
+#define _GNU_SOURCE     // Recursive mutex initialiser
+
+#include <freertos/FreeRTOS.h>
+#include <driver/spi_master.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+#include <esp_rom_sys.h>
+#include <esp_timer.h>
+#include <esp_cpu.h>
+#include <idf_host.h>
+#include <pthread.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+// Host stand-ins for the ESP-IDF GPIO, SPI master, timer and task functions used by the driver
+
+#define SPI_HOST_MAX_QUEUE_SIZE 64
+
+struct spi_device_t {
+    spi_device_interface_config_t config;
+    spi_transaction_t* results[SPI_HOST_MAX_QUEUE_SIZE];
+    uint64_t resultEndNs[SPI_HOST_MAX_QUEUE_SIZE];
+    uint8_t resultHead;
+    uint8_t resultCount;
+};
+
+static SpiHostSink spiSink = NULL;
+static void* spiSinkContext = NULL;
+static SpiHostStats spiStats;
+
+static uint8_t gpioLevels[GPIO_PIN_COUNT];
+static gpio_int_type_t gpioInterruptTypes[GPIO_PIN_COUNT];
+static gpio_isr_t gpioHandlers[GPIO_PIN_COUNT];
+static void* gpioHandlerArgs[GPIO_PIN_COUNT];
+static bool gpioIsrServiceInstalled = false;
+
+// Tasks may run on other threads, so time only moves under timeLock, and reads are atomic
+static pthread_mutex_t timeLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static uint64_t hostTimeNs = 0;
+static uint64_t busFreeNs = 0;         // When the last transaction handed to the bus is done
+static HostTimeEvent timeEvent = NULL;
+static void* timeEventContext = NULL;
+static uint64_t timeEventNs = 0;
+
+// Time
+// -----
+
+static void advanceTimeTo(uint64_t ns)
+{
+    pthread_mutex_lock(&timeLock);
+
+    while (timeEvent != NULL && timeEventNs <= ns) {
+        HostTimeEvent event = timeEvent;
+
+        if (timeEventNs > hostTimeNs) {
+            __atomic_store_n(&hostTimeNs, timeEventNs, __ATOMIC_RELAXED);
+        }
+        timeEvent = NULL;
+        event(hostTimeNs, timeEventContext);
+    }
+
+    if (ns > hostTimeNs) {
+        __atomic_store_n(&hostTimeNs, ns, __ATOMIC_RELAXED);
+    }
+
+    pthread_mutex_unlock(&timeLock);
+}
+
+uint64_t hostGetTimeNs()
+{
+    return __atomic_load_n(&hostTimeNs, __ATOMIC_RELAXED);
+}
+
+void hostAdvanceTimeNs(uint64_t ns)
+{
+    pthread_mutex_lock(&timeLock);
+    advanceTimeTo(hostTimeNs + ns);
+    pthread_mutex_unlock(&timeLock);
+}
+
+void hostSetTimeEvent(HostTimeEvent event, void* context, uint64_t atNs)
+{
+    timeEvent = event;
+    timeEventContext = context;
+    timeEventNs = atNs;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return hostGetTimeNs() / 1000;
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    hostAdvanceTimeNs((uint64_t)us * 1000);
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000000000ULL) + now.tv_nsec);
+}
+
+uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return 1000;
+}
+
+// GPIO
+// -----
+
+esp_err_t gpio_config(const gpio_config_t* config)
+{
+    if (config == NULL || (config->pin_bit_mask >> GPIO_PIN_COUNT) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t pin = 0; pin < GPIO_PIN_COUNT; ++pin)
+    {
+        if (config->pin_bit_mask & (1ULL << pin)) {
+            gpioInterruptTypes[pin] = config->intr_type;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_PIN_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpioLevels[gpio_num] = level ? 1 : 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_PIN_COUNT) {
+        return 0;
+    }
+    return gpioLevels[gpio_num];
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+
+    if (gpioIsrServiceInstalled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    gpioIsrServiceInstalled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void* args)
+{
+    if (!gpioIsrServiceInstalled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (gpio_num < 0 || gpio_num >= GPIO_PIN_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpioHandlers[gpio_num] = isr_handler;
+    gpioHandlerArgs[gpio_num] = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_PIN_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gpioHandlers[gpio_num] = NULL;
+    return ESP_OK;
+}
+
+void gpioHostSetInput(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= GPIO_PIN_COUNT) {
+        return;
+    }
+
+    uint8_t previous = gpioLevels[gpio_num];
+    uint8_t current = level ? 1 : 0;
+    bool fire = false;
+
+    gpioLevels[gpio_num] = current;
+
+    switch (gpioInterruptTypes[gpio_num]) {
+        case GPIO_INTR_POSEDGE:
+            fire = !previous && current;
+            break;
+        case GPIO_INTR_NEGEDGE:
+            fire = previous && !current;
+            break;
+        case GPIO_INTR_ANYEDGE:
+            fire = previous != current;
+            break;
+        case GPIO_INTR_LOW_LEVEL:
+            fire = !current;
+            break;
+        case GPIO_INTR_HIGH_LEVEL:
+            fire = current;
+            break;
+        default:
+            break;
+    }
+
+    if (fire && gpioIsrServiceInstalled && gpioHandlers[gpio_num] != NULL) {
+        gpioHandlers[gpio_num](gpioHandlerArgs[gpio_num]);
+    }
+}
+
+// Tasks
+// ------
+
+struct HostTask {
+    pthread_t thread;
+    TaskFunction_t code;
+    void* parameters;
+    pthread_mutex_t lock;
+    pthread_cond_t notified;
+    uint32_t notifications;
+};
+
+static __thread TaskHandle_t currentTask = NULL;
+
+// Other threads get a chance to run, as they would while the real scheduler had this task blocked
+void vTaskDelay(const TickType_t ticks)
+{
+    hostAdvanceTimeNs((uint64_t)ticks * portTICK_PERIOD_MS * 1000000ULL);
+    sched_yield();
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(hostGetTimeNs() / (portTICK_PERIOD_MS * 1000000ULL));
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, const TickType_t timeIncrement)
+{
+    TickType_t wakeTime = *previousWakeTime + timeIncrement;
+    TickType_t now = xTaskGetTickCount();
+
+    if ((int32_t)(wakeTime - now) > 0) {
+        vTaskDelay(wakeTime - now);
+    } else {
+        sched_yield();
+    }
+    *previousWakeTime = wakeTime;
+}
+
+static void* runTask(void* argument)
+{
+    TaskHandle_t task = (TaskHandle_t)argument;
+
+    currentTask = task;
+    task->code(task->parameters);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, const uint32_t stackDepth, void* parameters, UBaseType_t priority, TaskHandle_t* createdTask, const BaseType_t coreId)
+{
+    (void)name;
+    (void)stackDepth;
+    (void)priority;
+    (void)coreId;
+
+    TaskHandle_t task = calloc(1, sizeof(struct HostTask));
+    if (task == NULL) {
+        return pdFAIL;
+    }
+
+    task->code = code;
+    task->parameters = parameters;
+    pthread_mutex_init(&task->lock, NULL);
+    pthread_cond_init(&task->notified, NULL);
+
+    if (pthread_create(&task->thread, NULL, runTask, task) != 0) {
+        free(task);
+        return pdFAIL;
+    }
+    if (createdTask != NULL) {
+        *createdTask = task;
+    }
+    return pdPASS;
+}
+
+// Only a task deleting itself is supported. Its handle stays valid, so late notifications are harmless.
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL || task == currentTask) {
+        pthread_exit(NULL);
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return currentTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->lock);
+    ++task->notifications;
+    pthread_cond_signal(&task->notified);
+    pthread_mutex_unlock(&task->lock);
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    TaskHandle_t task = currentTask;
+    uint32_t notifications;
+
+    if (task == NULL) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&task->lock);
+
+    if (task->notifications == 0 && ticksToWait == portMAX_DELAY) {
+        while (task->notifications == 0) {
+            pthread_cond_wait(&task->notified, &task->lock);
+        }
+    } else if (task->notifications == 0 && ticksToWait > 0) {
+        struct timespec until;
+        uint64_t waitNs = (uint64_t)ticksToWait * portTICK_PERIOD_MS * 1000000ULL;
+
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += (until.tv_nsec + waitNs) / 1000000000ULL;
+        until.tv_nsec = (until.tv_nsec + waitNs) % 1000000000ULL;
+
+        while (task->notifications == 0 && pthread_cond_timedwait(&task->notified, &task->lock, &until) == 0) {
+        }
+    }
+
+    notifications = task->notifications;
+    if (notifications > 0) {
+        task->notifications = clearCountOnExit ? 0 : notifications - 1;
+    }
+
+    pthread_mutex_unlock(&task->lock);
+    return notifications;
+}
+
+// SPI master
+// -----------
+
+// Returns the host time the transaction is done, as it starts once the bus is free of the ones before it. Devices on
+// the bus may be driven from different tasks, so the bus is only touched under timeLock.
+static uint64_t executeTransaction(spi_device_handle_t handle, spi_transaction_t* transaction, SpiHostTransactionKind kind)
+{
+    pthread_mutex_lock(&timeLock);
+
+    uint64_t nowNs = hostGetTimeNs();
+    uint64_t startNs = (busFreeNs > nowNs) ? busFreeNs : nowNs;
+
+    if (handle->config.clock_speed_hz > 0) {
+        busFreeNs = startNs + ((uint64_t)transaction->length * 1000000000ULL) / handle->config.clock_speed_hz;
+    } else {
+        busFreeNs = startNs;
+    }
+
+    // CS is low for the length of the transaction, which is what tells the devices on a shared bus apart
+    if (handle->config.spics_io_num >= 0) {
+        gpio_set_level(handle->config.spics_io_num, 0);
+    }
+
+    if (handle->config.pre_cb != NULL) {
+        handle->config.pre_cb(transaction);
+    }
+
+    ++spiStats.transactions;
+    spiStats.bytes += transaction->length / 8;
+
+    if (spiSink != NULL) {
+        spiSink(transaction, kind, handle->config.clock_speed_hz, startNs, spiSinkContext);
+    }
+
+    if (handle->config.post_cb != NULL) {
+        handle->config.post_cb(transaction);
+    }
+
+    if (handle->config.spics_io_num >= 0) {
+        gpio_set_level(handle->config.spics_io_num, 1);
+    }
+
+    uint64_t endNs = busFreeNs;
+
+    pthread_mutex_unlock(&timeLock);
+    return endNs;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t* dev_config, spi_device_handle_t* handle)
+{
+    (void)host;
+
+    if (dev_config == NULL || handle == NULL || dev_config->queue_size <= 0 || dev_config->queue_size > SPI_HOST_MAX_QUEUE_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    spi_device_handle_t device = calloc(1, sizeof(struct spi_device_t));
+    if (device == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    device->config = *dev_config;
+    *handle = device;
+
+    // Deselected until its first transaction
+    if (dev_config->spics_io_num >= 0) {
+        gpio_set_level(dev_config->spics_io_num, 1);
+    }
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    if (handle == NULL || handle->resultCount > 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t* trans_desc, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&timeLock);
+
+    // Nothing drains the queue behind the caller's back on the host, so a full queue would block forever
+    if (handle->resultCount >= handle->config.queue_size) {
+        ++spiStats.queueFullErrors;
+        pthread_mutex_unlock(&timeLock);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint8_t slot = (handle->resultHead + handle->resultCount) % SPI_HOST_MAX_QUEUE_SIZE;
+
+    ++spiStats.queuedTransactions;
+    handle->resultEndNs[slot] = executeTransaction(handle, trans_desc, SPI_HOST_QUEUED);
+    handle->results[slot] = trans_desc;
+    ++handle->resultCount;
+
+    if (handle->resultCount > spiStats.maxQueueDepth) {
+        spiStats.maxQueueDepth = handle->resultCount;
+    }
+
+    pthread_mutex_unlock(&timeLock);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t** trans_desc, TickType_t ticks_to_wait)
+{
+    (void)ticks_to_wait;
+
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->resultCount == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    advanceTimeTo(handle->resultEndNs[handle->resultHead]);
+
+    *trans_desc = handle->results[handle->resultHead];
+    handle->resultHead = (handle->resultHead + 1) % SPI_HOST_MAX_QUEUE_SIZE;
+    --handle->resultCount;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t* trans_desc)
+{
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The real driver asserts here, as the result it collects would belong to an earlier queued transaction
+    if (handle->resultCount > 0) {
+        ++spiStats.orderingErrors;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    __atomic_add_fetch(&spiStats.blockingTransactions, 1, __ATOMIC_RELAXED);
+    advanceTimeTo(executeTransaction(handle, trans_desc, SPI_HOST_BLOCKING));
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t* trans_desc)
+{
+    if (handle == NULL || trans_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (handle->resultCount > 0) {
+        ++spiStats.orderingErrors;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    __atomic_add_fetch(&spiStats.pollingTransactions, 1, __ATOMIC_RELAXED);
+    advanceTimeTo(executeTransaction(handle, trans_desc, SPI_HOST_POLLING));
+    return ESP_OK;
+}
+
+// Inspection
+// -----------
+
+void spiHostSetSink(SpiHostSink sink, void* context)
+{
+    spiSink = sink;
+    spiSinkContext = context;
+}
+
+void spiHostGetStats(SpiHostStats* stats)
+{
+    *stats = spiStats;
+}
+
+void spiHostResetStats()
+{
+    memset(&spiStats, 0, sizeof(spiStats));
+}
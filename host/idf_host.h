@@ -0,0 +1,49 @@
+#ifndef __IDF_HOST_H__
+#define __IDF_HOST_H__
+
+// Inspection and hook API for the host stand-ins of the ESP-IDF drivers
+
+#include <freertos/FreeRTOS.h>
+#include <driver/spi_master.h>
+#include <driver/gpio.h>
+
+typedef enum SpiHostTransactionKind {
+    SPI_HOST_QUEUED = 0,
+    SPI_HOST_BLOCKING,
+    SPI_HOST_POLLING
+} SpiHostTransactionKind;
+
+typedef struct SpiHostStats {
+    uint32_t transactions;
+    uint32_t queuedTransactions;
+    uint32_t blockingTransactions;
+    uint32_t pollingTransactions;
+    uint64_t bytes;
+    uint8_t maxQueueDepth;          // Most transactions queued but not yet collected at any one time
+    uint32_t queueFullErrors;
+    uint32_t orderingErrors;        // Blocking or polling transactions started while queued ones were still in flight
+} SpiHostStats;
+
+// Called for every transaction once it is on the wire, after pre_cb and before post_cb. startNs is the host time its
+// first bit goes out, which is later than hostGetTimeNs while earlier queued transactions are still on the bus.
+typedef void (*SpiHostSink)(const spi_transaction_t* transaction, SpiHostTransactionKind kind, int clockSpeedHz, uint64_t startNs, void* context);
+
+void spiHostSetSink(SpiHostSink sink, void* context);
+void spiHostGetStats(SpiHostStats* stats);
+void spiHostResetStats();
+
+// Host time is simulated, so timing is repeatable. It starts at 0 and only moves on vTaskDelay, esp_rom_delay_us and
+// while waiting on SPI transactions; esp_timer_get_time reads it.
+typedef void (*HostTimeEvent)(uint64_t nowNs, void* context);
+
+uint64_t hostGetTimeNs();
+void hostAdvanceTimeNs(uint64_t ns);
+
+// One shot event, run with host time set to atNs once time reaches it. The event may schedule the next one. There is
+// a single slot, so a new event replaces any pending one.
+void hostSetTimeEvent(HostTimeEvent event, void* context, uint64_t atNs);
+
+// Drives an input pin from outside, running its ISR handler on a matching edge
+void gpioHostSetInput(gpio_num_t gpio_num, uint32_t level);
+
+#endif  /* __IDF_HOST_H__ */
@@ -0,0 +1,441 @@
+#include <freertos/FreeRTOS.h>
+#include <ili9341_simulator.h>
+#include <driver/gpio.h>
+#include <ili9341.h>
+#include <string.h>
+
+static void scheduleTearingEffect(Ili9341Simulator* sim, uint64_t nowNs);
+
+// MADCTL bits
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+
+// Setup
+// ------
+
+// Power on defaults, leaving GRAM, configuration and statistics alone
+static void resetController(Ili9341Simulator* sim)
+{
+    sim->command = ILI9341_NOP;
+    sim->parameterCount = 0;
+    sim->pixelHalfPending = false;
+    sim->columnStart = 0;
+    sim->pageStart = 0;
+    sim->column = 0;
+    sim->page = 0;
+    sim->madctl = 0x00;
+    sim->displayOn = false;
+    sim->topFixedArea = 0;
+    sim->bottomFixedArea = 0;
+    sim->scrollStart = 0;
+    sim->columnEnd = SIMULATOR_GRAM_WIDTH - 1;
+    sim->pageEnd = SIMULATOR_GRAM_HEIGHT - 1;
+    sim->pixelFormat = 0x66;
+    sim->sleeping = true;
+    sim->scrollArea = SIMULATOR_GRAM_HEIGHT;
+    sim->tearingEffectOn = false;
+    sim->frameRateDivision = 0;
+    sim->clocksPerLine = 0x1B;
+    sim->frontPorch = 2;
+    sim->backPorch = 2;
+}
+
+void simulatorInit(Ili9341Simulator* sim, int dcPin)
+{
+    memset(sim, 0, sizeof(Ili9341Simulator));
+
+    sim->dcPin = dcPin;
+    sim->csPin = -1;
+    sim->tePin = -1;
+
+    // Rough costs of getting a transaction onto the bus on an ESP32, beyond the bits themselves
+    sim->transactionOverheadNs[SPI_HOST_QUEUED] = 2000;
+    sim->transactionOverheadNs[SPI_HOST_BLOCKING] = 15000;
+    sim->transactionOverheadNs[SPI_HOST_POLLING] = 4000;
+
+    resetController(sim);
+}
+
+void simulatorResetStats(Ili9341Simulator* sim)
+{
+    memset(&sim->stats, 0, sizeof(SimulatorStats));
+}
+
+// Refresh
+// --------
+
+uint64_t simulatorLineTimeNs(const Ili9341Simulator* sim)
+{
+    uint8_t clocks = (sim->clocksPerLine < 0x10) ? 0x10 : sim->clocksPerLine;
+    return ((uint64_t)clocks << sim->frameRateDivision) * 1000000000ULL / SIMULATOR_OSCILLATOR_HZ;
+}
+
+uint64_t simulatorFramePeriodNs(const Ili9341Simulator* sim)
+{
+    return simulatorLineTimeNs(sim) * (SIMULATOR_GRAM_HEIGHT + sim->frontPorch + sim->backPorch);
+}
+
+uint16_t simulatorScanLine(const Ili9341Simulator* sim, uint64_t timeNs)
+{
+    if (timeNs < sim->scanOriginNs) {
+        return SIMULATOR_GRAM_HEIGHT;
+    }
+
+    uint32_t line = (uint32_t)(((timeNs - sim->scanOriginNs) % simulatorFramePeriodNs(sim)) / simulatorLineTimeNs(sim));
+
+    if (line < sim->backPorch || line >= (uint32_t)(sim->backPorch + SIMULATOR_GRAM_HEIGHT)) {
+        return SIMULATOR_GRAM_HEIGHT;
+    }
+    return line - sim->backPorch;
+}
+
+// Display line showing a GRAM row, the inverse of the scrolling in simulatorDisplayedPixel
+static uint16_t displayLineOfRow(const Ili9341Simulator* sim, uint16_t row)
+{
+    if (row < sim->topFixedArea || row >= sim->topFixedArea + sim->scrollArea || sim->scrollArea == 0) {
+        return row;
+    }
+
+    uint16_t start = sim->scrollStart;
+    if (start < sim->topFixedArea || start >= sim->topFixedArea + sim->scrollArea) {
+        start = sim->topFixedArea;
+    }
+    return sim->topFixedArea + ((row + sim->scrollArea - start) % sim->scrollArea);
+}
+
+// Number of the first refresh that shows a pixel of row written at timeNs
+static int64_t refreshShowingRow(const Ili9341Simulator* sim, uint16_t row, uint64_t timeNs)
+{
+    int64_t period = simulatorFramePeriodNs(sim);
+    int64_t sinceScan = (int64_t)timeNs - (int64_t)sim->scanOriginNs - (int64_t)((sim->backPorch + displayLineOfRow(sim, row)) * simulatorLineTimeNs(sim));
+
+    return (sinceScan <= 0) ? -((-sinceScan) / period) : ((sinceScan + period - 1) / period);
+}
+
+// TE is high through the vertical blanking, from the end of the last line to the start of the first
+static void tearingEffectEdge(uint64_t nowNs, void* context)
+{
+    Ili9341Simulator* sim = (Ili9341Simulator*)context;
+
+    gpioHostSetInput(sim->tePin, simulatorScanLine(sim, nowNs) == SIMULATOR_GRAM_HEIGHT);
+    scheduleTearingEffect(sim, nowNs);
+}
+
+static void scheduleTearingEffect(Ili9341Simulator* sim, uint64_t nowNs)
+{
+    if (sim->tePin < 0) {
+        return;
+    }
+    if (!sim->tearingEffectOn) {
+        hostSetTimeEvent(NULL, NULL, 0);
+        gpio_set_level(sim->tePin, 0);
+        return;
+    }
+
+    uint64_t period = simulatorFramePeriodNs(sim);
+    uint64_t lineTime = simulatorLineTimeNs(sim);
+    uint64_t frameStart = nowNs - ((nowNs - sim->scanOriginNs) % period);
+    uint64_t edges[3] = {
+        frameStart + (sim->backPorch * lineTime),
+        frameStart + ((sim->backPorch + SIMULATOR_GRAM_HEIGHT) * lineTime),
+        frameStart + period + (sim->backPorch * lineTime)
+    };
+    uint8_t next = 0;
+
+    while (edges[next] <= nowNs) {
+        ++next;
+    }
+
+    // Follow the current level quietly, so turning TE on part way through blanking does not look like an edge
+    gpio_set_level(sim->tePin, simulatorScanLine(sim, nowNs) == SIMULATOR_GRAM_HEIGHT);
+    hostSetTimeEvent(tearingEffectEdge, sim, edges[next]);
+}
+
+// Frame timing changes restart the scan
+static void restartScan(Ili9341Simulator* sim, uint64_t nowNs)
+{
+    sim->scanOriginNs = nowNs;
+    scheduleTearingEffect(sim, nowNs);
+}
+
+// Decoding
+// ---------
+
+static void writePixel(Ili9341Simulator* sim, uint16_t colour, uint64_t timeNs)
+{
+    uint16_t x = sim->column;
+    uint16_t y = sim->page;
+
+    if (sim->madctl & MADCTL_MV) {
+        uint16_t swap = x;
+        x = y;
+        y = swap;
+    }
+    if (sim->madctl & MADCTL_MX) {
+        x = SIMULATOR_GRAM_WIDTH - 1 - x;
+    }
+    if (sim->madctl & MADCTL_MY) {
+        y = SIMULATOR_GRAM_HEIGHT - 1 - y;
+    }
+
+    if (x < SIMULATOR_GRAM_WIDTH && y < SIMULATOR_GRAM_HEIGHT) {
+        sim->gram[y][x] = colour;
+
+        if (sim->displayOn && !sim->sleeping) {
+            int64_t refresh = refreshShowingRow(sim, y, timeNs);
+
+            if (sim->writeRefresh < 0) {
+                sim->writeRefresh = refresh;
+            } else if (refresh != sim->writeRefresh && !sim->writeTorn) {
+                sim->writeTorn = true;
+                ++sim->stats.tornMemoryWrites;
+            }
+        }
+    }
+    ++sim->stats.pixelsWritten;
+
+    // Column first, then page, wrapping back to the window start
+    if (sim->column < sim->columnEnd) {
+        ++sim->column;
+    } else {
+        sim->column = sim->columnStart;
+        sim->page = (sim->page < sim->pageEnd) ? sim->page + 1 : sim->pageStart;
+    }
+}
+
+static void startCommand(Ili9341Simulator* sim, uint8_t command, uint64_t timeNs)
+{
+    sim->command = command;
+    sim->parameterCount = 0;
+    sim->pixelHalfPending = false;
+    ++sim->stats.commands;
+
+    switch (command) {
+        case ILI9341_RESET:
+            resetController(sim);
+            restartScan(sim, timeNs);
+            break;
+        case ILI9341_SLEEP_OUT:
+            sim->sleeping = false;
+            break;
+        case ILI9341_ENTER_SLEEP_MODE:
+            sim->sleeping = true;
+            break;
+        case ILI9341_DISPLAY_ON:
+            sim->displayOn = true;
+            break;
+        case ILI9341_DISPLAY_OFF:
+            sim->displayOn = false;
+            break;
+        case ILI9341_WRITE_RAM:
+            sim->column = sim->columnStart;
+            sim->page = sim->pageStart;
+            sim->writeRefresh = -1;
+            sim->writeTorn = false;
+            ++sim->stats.memoryWrites;
+            break;
+        case ILI9341_TEARING_EFFECT_LINE_ON:
+            sim->tearingEffectOn = true;
+            scheduleTearingEffect(sim, timeNs);
+            break;
+        case ILI9341_TEARING_EFFECT_LINE_OFF:
+            sim->tearingEffectOn = false;
+            scheduleTearingEffect(sim, timeNs);
+            break;
+        case ILI9341_WMC:
+            ++sim->stats.memoryWrites;
+            break;
+        default:
+            break;
+    }
+}
+
+static void parameterComplete(Ili9341Simulator* sim, uint64_t timeNs)
+{
+    uint8_t* p = sim->parameters;
+
+    switch (sim->command) {
+        case ILI9341_COLUMN_ADDR:
+            if (sim->parameterCount == 4) {
+                sim->columnStart = (p[0] << 8) | p[1];
+                sim->columnEnd = (p[2] << 8) | p[3];
+                ++sim->stats.columnAddressSets;
+            }
+            break;
+        case ILI9341_PAGE_ADDR:
+            if (sim->parameterCount == 4) {
+                sim->pageStart = (p[0] << 8) | p[1];
+                sim->pageEnd = (p[2] << 8) | p[3];
+                ++sim->stats.pageAddressSets;
+            }
+            break;
+        case ILI9341_MEMORY_ACCESS_CONTROL:
+            if (sim->parameterCount == 1) {
+                sim->madctl = p[0];
+            }
+            break;
+        case ILI9341_PIXEL_FORMAT:
+            if (sim->parameterCount == 1) {
+                sim->pixelFormat = p[0];
+            }
+            break;
+        case ILI9341_VERTICAL_SCROLLING_DEFINITION:
+            if (sim->parameterCount == 6) {
+                sim->topFixedArea = (p[0] << 8) | p[1];
+                sim->scrollArea = (p[2] << 8) | p[3];
+                sim->bottomFixedArea = (p[4] << 8) | p[5];
+            }
+            break;
+        case ILI9341_VERTICAL_SCROLLING_START_ADDRESS:
+            if (sim->parameterCount == 2) {
+                sim->scrollStart = (p[0] << 8) | p[1];
+            }
+            break;
+        case ILI9341_FRAME_RATE_CONTROL:
+            if (sim->parameterCount == 2) {
+                sim->frameRateDivision = p[0] & 0x03;
+                sim->clocksPerLine = p[1] & 0x1F;
+                restartScan(sim, timeNs);
+            }
+            break;
+        case ILI9341_BPC:
+            if (sim->parameterCount == 2) {
+                sim->frontPorch = p[0] & 0x7F;
+                sim->backPorch = p[1] & 0x7F;
+                restartScan(sim, timeNs);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void dataByte(Ili9341Simulator* sim, uint8_t byte, uint64_t timeNs)
+{
+    if (sim->command == ILI9341_WRITE_RAM || sim->command == ILI9341_WMC) {
+        if (sim->pixelHalfPending) {
+            writePixel(sim, (sim->pixelHighByte << 8) | byte, timeNs);
+            sim->pixelHalfPending = false;
+        } else {
+            sim->pixelHighByte = byte;
+            sim->pixelHalfPending = true;
+        }
+        return;
+    }
+
+    ++sim->stats.parameterBytes;
+    if (sim->parameterCount < SIMULATOR_MAX_PARAMETERS) {
+        sim->parameters[sim->parameterCount++] = byte;
+        parameterComplete(sim, timeNs);
+    }
+}
+
+void simulatorFeed(Ili9341Simulator* sim, const uint8_t* bytes, size_t length, bool data, SpiHostTransactionKind kind, int clockSpeedHz, uint64_t startNs)
+{
+    int clock = sim->clockSpeedHz ? sim->clockSpeedHz : clockSpeedHz;
+
+    ++sim->stats.transactions;
+    sim->stats.busTimeNs += sim->transactionOverheadNs[kind];
+    if (clock > 0) {
+        sim->stats.busTimeNs += ((uint64_t)length * 8000000000ULL) / clock;
+    }
+
+    if (data && (sim->command == ILI9341_WRITE_RAM || sim->command == ILI9341_WMC)) {
+        ++sim->stats.pixelTransactions;
+    } else {
+        ++sim->stats.setupTransactions;
+    }
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        // Each byte is done once its last bit is out
+        uint64_t timeNs = startNs + ((clock > 0) ? ((uint64_t)(i + 1) * 8000000000ULL) / clock : 0);
+
+        if (data) {
+            dataByte(sim, bytes[i], timeNs);
+        } else {
+            startCommand(sim, bytes[i], timeNs);
+        }
+    }
+}
+
+static Ili9341Simulator* attachedSimulators[SIMULATOR_MAX_ATTACHED];
+static uint8_t attachedCount = 0;
+
+static void simulatorSink(const spi_transaction_t* transaction, SpiHostTransactionKind kind, int clockSpeedHz, uint64_t startNs, void* context)
+{
+    (void)context;
+
+    for (uint8_t i = 0; i < attachedCount; ++i)
+    {
+        Ili9341Simulator* sim = attachedSimulators[i];
+
+        if (sim->csPin < 0 || gpio_get_level(sim->csPin) == 0) {
+            const uint8_t* bytes = (transaction->flags & SPI_TRANS_USE_TXDATA) ? transaction->tx_data : (const uint8_t*)transaction->tx_buffer;
+
+            simulatorFeed(sim, bytes, transaction->length / 8, gpio_get_level(sim->dcPin), kind, clockSpeedHz, startNs);
+        }
+    }
+}
+
+void simulatorAttach(Ili9341Simulator* sim)
+{
+    for (uint8_t i = 0; i < attachedCount; ++i)
+    {
+        if (attachedSimulators[i] == sim) {
+            return;
+        }
+    }
+
+    if (attachedCount < SIMULATOR_MAX_ATTACHED) {
+        attachedSimulators[attachedCount++] = sim;
+    }
+    spiHostSetSink(simulatorSink, NULL);
+}
+
+// Output
+// -------
+
+uint16_t simulatorDisplayedPixel(const Ili9341Simulator* sim, uint16_t x, uint16_t y)
+{
+    uint16_t row = y;
+
+    // Lines inside the scroll area start from the scroll start address and wrap within the area
+    if (y >= sim->topFixedArea && y < sim->topFixedArea + sim->scrollArea && sim->scrollArea > 0) {
+        uint16_t start = sim->scrollStart;
+        if (start < sim->topFixedArea || start >= sim->topFixedArea + sim->scrollArea) {
+            start = sim->topFixedArea;
+        }
+        row = sim->topFixedArea + (((start - sim->topFixedArea) + (y - sim->topFixedArea)) % sim->scrollArea);
+    }
+
+    return sim->gram[row % SIMULATOR_GRAM_HEIGHT][x % SIMULATOR_GRAM_WIDTH];
+}
+
+bool simulatorDumpPpm(const Ili9341Simulator* sim, const char* path, bool displayed)
+{
+    FILE* file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", SIMULATOR_GRAM_WIDTH, SIMULATOR_GRAM_HEIGHT);
+
+    for (uint16_t y = 0; y < SIMULATOR_GRAM_HEIGHT; ++y)
+    {
+        for (uint16_t x = 0; x < SIMULATOR_GRAM_WIDTH; ++x)
+        {
+            uint16_t colour = displayed ? simulatorDisplayedPixel(sim, x, y) : sim->gram[y][x];
+            uint8_t rgb[3] = {
+                (uint8_t)(((colour >> 11) & 0x1F) * 255 / 31),
+                (uint8_t)(((colour >> 5) & 0x3F) * 255 / 63),
+                (uint8_t)((colour & 0x1F) * 255 / 31)
+            };
+            fwrite(rgb, 1, 3, file);
+        }
+    }
+
+    return fclose(file) == 0;
+}
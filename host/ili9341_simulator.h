@@ -0,0 +1,99 @@
+#ifndef __ILI9341_SIMULATOR_H__
+#define __ILI9341_SIMULATOR_H__
+
+// Simulated ILI9341 controller for host builds. Decodes the command stream seen by the SPI stand-in into a
+// GRAM model, and keeps an estimate of how long the transfers would take on the wire. The panel refresh is modelled
+// on host time, one line at a time at the rate set by FRMCTR1 and the blanking porches, so it can tell when a memory
+// write races the scan and drive a TE pin.
+
+#include <freertos/FreeRTOS.h>
+#include <idf_host.h>
+
+#define SIMULATOR_GRAM_WIDTH    240
+#define SIMULATOR_GRAM_HEIGHT   320
+#define SIMULATOR_MAX_PARAMETERS 16
+#define SIMULATOR_OSCILLATOR_HZ 615000
+
+typedef struct SimulatorStats {
+    uint32_t transactions;
+    uint32_t setupTransactions;     // Carrying commands or parameters, the cost of getting a window ready
+    uint32_t pixelTransactions;     // Carrying nothing but pixel data
+    uint32_t commands;
+    uint32_t columnAddressSets;
+    uint32_t pageAddressSets;
+    uint32_t memoryWrites;
+    uint64_t parameterBytes;
+    uint64_t pixelsWritten;
+    uint64_t busTimeNs;             // Bits on the wire at the modelled clock plus per transaction overhead
+    uint32_t tornMemoryWrites;      // Memory writes that were partly shown by one refresh and partly by the next
+} SimulatorStats;
+
+typedef struct Ili9341Simulator {
+    uint16_t gram[SIMULATOR_GRAM_HEIGHT][SIMULATOR_GRAM_WIDTH];   // Native RGB565, not wire order
+
+    int dcPin;
+    int csPin;                      // Transactions with it high are for another device on the bus, -1 when always selected
+    int tePin;                      // Driven with the tearing effect output, -1 when not wired
+    int clockSpeedHz;               // 0 uses the clock the SPI device was added with
+    uint32_t transactionOverheadNs[3]; // Indexed by SpiHostTransactionKind
+
+    // Command decoding
+    uint8_t command;
+    uint8_t parameters[SIMULATOR_MAX_PARAMETERS];
+    uint8_t parameterCount;
+    bool pixelHalfPending;
+    uint8_t pixelHighByte;
+
+    // Controller state
+    uint16_t columnStart;
+    uint16_t columnEnd;
+    uint16_t pageStart;
+    uint16_t pageEnd;
+    uint16_t column;
+    uint16_t page;
+    uint8_t madctl;
+    uint8_t pixelFormat;
+    bool sleeping;
+    bool displayOn;
+    uint16_t topFixedArea;
+    uint16_t scrollArea;
+    uint16_t bottomFixedArea;
+    uint16_t scrollStart;
+    bool tearingEffectOn;
+    uint8_t frameRateDivision;      // FRMCTR1 DIVA
+    uint8_t clocksPerLine;          // FRMCTR1 RTNA
+    uint8_t frontPorch;
+    uint8_t backPorch;
+
+    // Refresh scan. Frames start at scanOriginNs with the back porch, then the GRAM lines, then the front porch.
+    uint64_t scanOriginNs;
+    int64_t writeRefresh;           // Refresh that first shows the current memory write
+    bool writeTorn;
+
+    SimulatorStats stats;
+} Ili9341Simulator;
+
+void simulatorInit(Ili9341Simulator* sim, int dcPin);
+// Routes SPI stand-in transactions to sim. Up to SIMULATOR_MAX_ATTACHED simulators share the bus, each seeing the
+// transactions its csPin selects.
+#define SIMULATOR_MAX_ATTACHED 4
+void simulatorAttach(Ili9341Simulator* sim);
+
+// Decodes one transaction of length bytes without going through the SPI stand-in, as when replaying a trace. data is
+// the D/C level.
+void simulatorFeed(Ili9341Simulator* sim, const uint8_t* bytes, size_t length, bool data, SpiHostTransactionKind kind, int clockSpeedHz, uint64_t startNs);
+void simulatorResetStats(Ili9341Simulator* sim);
+
+// Pixel as the panel shows it, with vertical scrolling applied
+uint16_t simulatorDisplayedPixel(const Ili9341Simulator* sim, uint16_t x, uint16_t y);
+
+uint64_t simulatorLineTimeNs(const Ili9341Simulator* sim);
+uint64_t simulatorFramePeriodNs(const Ili9341Simulator* sim);
+
+// Display line being refreshed at host time timeNs, or SIMULATOR_GRAM_HEIGHT during vertical blanking
+uint16_t simulatorScanLine(const Ili9341Simulator* sim, uint64_t timeNs);
+
+// Writes a binary PPM. displayed selects the scrolled panel view instead of raw GRAM.
+bool simulatorDumpPpm(const Ili9341Simulator* sim, const char* path, bool displayed);
+
+#endif  /* __ILI9341_SIMULATOR_H__ */
@@ -1,838 +1,3857 @@
-#include <freertos/FreeRTOS.h>
-#include <driver/spi_master.h>
-#include <global_variables.h>
-#include <freertos/task.h>
-#include <driver/gpio.h>
-#include <settings.h>
-#include <colours.h>
-#include <ili9341.h>
-#include <string.h>
-#include <images.h>
-#include <fonts.h>
-#include <math.h>
-
-// #include <esp_heap_caps.h>
-
-static uint16_t screenBuffer[SCREEN_PIXELS_SIZE]; // [SCREEN_HEIGHT * SCREEN_WIDTH]
-
-typedef struct TFT_t {
-    uint16_t _model;
-    uint16_t _width;
-    uint16_t _height;
-    uint16_t _offsetx;
-    uint16_t _offsety;
-    uint16_t _font_direction;
-    uint16_t _font_fill;
-    uint16_t _font_fill_color;
-    uint16_t _font_underline;
-    uint16_t _font_underline_color;
-    int16_t _dc;
-    int16_t _bl;
-    spi_device_handle_t _SPIHandle;
-} TFT_t;
-
-TFT_t dev;
-
-// SPI transmission functions
-// ---------------------------
-
-bool spi_master_write_bytes_screen(const uint8_t* data, size_t dataLength)
-{
-    spi_transaction_t SPITransaction;
-
-    if ( dataLength > 0 ) {
-        memset( &SPITransaction, 0, sizeof(spi_transaction_t) );
-        SPITransaction.length = dataLength * 8;
-        SPITransaction.tx_buffer = data;
-        return !spi_device_transmit(dev._SPIHandle, &SPITransaction);
-    }
-    ERROR("Tried to send 0 bytes to screen!");
-    return false;
-}
-
-bool sendByte(DataOrCommand doc, uint8_t byte)
-{
-    // DC pin should by default in DATA mode, and changed to COMMAND only while sending, and then reset!
-
-    if (doc == COMMAND) { 
-        gpio_set_level(dev._dc, COMMAND);
-        if (spi_master_write_bytes_screen(&byte, 1)) {
-            gpio_set_level(dev._dc, DATA);
-            return true;
-        } else {
-            ERROR("Could not write 8 bit command to ILI9341 screen!");
-            gpio_set_level(dev._dc, DATA);
-            return false;
-        }
-    } else {
-        if (spi_master_write_bytes_screen(&byte, 1)) {
-            return true;
-        } else {
-            ERROR("Could not write 8 bit data to ILI9341 screen!");
-            return false;
-        }
-    }
-}
-
-// Utility
-// --------
-
-bool setScreenWriteArea(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
-{
-    static uint8_t data[4];
-
-    sendByte(COMMAND, ILI9341_COLUMN_ADDR);
-    data[0] = (x1 >> 8) & 0xFF;
-    data[1] = x1 & 0xFF;
-    data[2] = (x2 >> 8) & 0xFF;
-    data[3] = x2 & 0xFF;
-    if (!spi_master_write_bytes_screen(data, 4)) {
-        ERROR("Could not set column adress on screen");
-        return false;
-    }
-
-    sendByte(COMMAND, ILI9341_PAGE_ADDR);
-    data[0] = (y1 >> 8) & 0xFF;
-    data[1] = y1 & 0xFF;
-    data[2] = (y2 >> 8) & 0xFF;
-    data[3] = y2 & 0xFF;
-    if (!spi_master_write_bytes_screen(data, 4)) {    
-        ERROR("Could not set page adress on screen");
-        return false;
-    }
-
-    sendByte(COMMAND, ILI9341_WRITE_RAM);
-    return true;
-}
-
-uint16_t reverseBytes(uint16_t num)
-{
-    return (((num & 0xff00) >> 8) | ((num & 0x00ff) << 8));
-}
-
-// Setup
-// ------
-
-bool setupScreenIO();
-
-bool setupScreen()
-{
-    // STATUS("Free size: %i with largest block: %i while trying to malloc %i", heap_caps_get_free_size(MALLOC_CAP_8BIT), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), SCREEN_BYTES_SIZE);
-
-    // screenBuffer = { 0 };
-    //screenBuffer =  malloc(SCREEN_BYTES_SIZE);
-    if (screenBuffer == NULL) {
-        ERROR("Screen buffer not allocated!");
-        return false;
-    }
-    initFonts();
-
-    setupScreenIO();
-
-    sendByte(COMMAND, ILI9341_POWER1);  //Power Control 1
-    sendByte(DATA, 0x23);
-
-    sendByte(COMMAND, ILI9341_POWER2);  //Power Control 2
-    sendByte(DATA, 0x10);
-
-    sendByte(COMMAND, ILI9341_VCOM1);  //VCOM Control 1
-    sendByte(DATA, 0x3E);
-    sendByte(DATA, 0x28);
-
-    sendByte(COMMAND, ILI9341_VCOM2);  //VCOM Control 2
-    sendByte(DATA, 0x86);
-
-    sendByte(COMMAND, ILI9341_MEMORY_ACCESS_CONTROL);  //Memory Access Control
-    sendByte(DATA, 0x08); // Bottom right start, RGB color filter panel
-
-    sendByte(COMMAND, ILI9341_PIXEL_FORMAT);  //Pixel Format Set
-    sendByte(DATA, 0x55);  //65K color: 16-bit/pixel
-
-    sendByte(COMMAND, ILI9341_DISPLAY_INVERSION_OFF);  // Display Inversion OFF
-
-    sendByte(COMMAND, ILI9341_FRAME_RATE_CONTROL);  //Frame Rate Control
-    sendByte(DATA, 0x00);
-    sendByte(DATA, 0x18);
-
-    sendByte(COMMAND, ILI9341_DISPLAY_FUNCTION_CONTROL);  //Display Function Control
-    sendByte(DATA, 0x08);
-    sendByte(DATA, 0xA2);  // REV:1 GS:0 SS:0 SM:0
-    sendByte(DATA, 0x27);
-    sendByte(DATA, 0x00);
-
-    sendByte(COMMAND, ILI9341_SET_GAMMA);  //Gamma Set
-    sendByte(DATA, 0x01);
-
-    sendByte(COMMAND, ILI9341_POSITIVE_GAMMA_CORRECTION);  //Positive Gamma Correction
-    sendByte(DATA, 0x0F);
-    sendByte(DATA, 0x31);
-    sendByte(DATA, 0x2B);
-    sendByte(DATA, 0x0C);
-    sendByte(DATA, 0x0E);
-    sendByte(DATA, 0x08);
-    sendByte(DATA, 0x4E);
-    sendByte(DATA, 0xF1);
-    sendByte(DATA, 0x37);
-    sendByte(DATA, 0x07);
-    sendByte(DATA, 0x10);
-    sendByte(DATA, 0x03);
-    sendByte(DATA, 0x0E);
-    sendByte(DATA, 0x09);
-    sendByte(DATA, 0x00);
-
-    sendByte(COMMAND, ILI9341_NEGATIVE_GAMMA_CORRECTION);  //Negative Gamma Correction
-    sendByte(DATA, 0x00);
-    sendByte(DATA, 0x0E);
-    sendByte(DATA, 0x14);
-    sendByte(DATA, 0x03);
-    sendByte(DATA, 0x11);
-    sendByte(DATA, 0x07);
-    sendByte(DATA, 0x31);
-    sendByte(DATA, 0xC1);
-    sendByte(DATA, 0x48);
-    sendByte(DATA, 0x08);
-    sendByte(DATA, 0x0F);
-    sendByte(DATA, 0x0C);
-    sendByte(DATA, 0x31);
-    sendByte(DATA, 0x36);
-    sendByte(DATA, 0x0F);
-
-    sendByte(COMMAND, ILI9341_SLEEP_OUT);  //Sleep Out
-    vTaskDelay(milliseconds(120));
-
-    sendByte(COMMAND, ILI9341_DISPLAY_ON);  //Display ON
-
-    LOG_BLUE("DONE WITH SCREEN SETUP!\n");
-    return true;
-}
-
-bool setupScreenIO()
-{
-    gpio_config_t gpio_conf;                        // Configuration struct    
-    gpio_conf.intr_type = GPIO_INTR_DISABLE;        // Disable interrupt
-    gpio_conf.mode = GPIO_MODE_OUTPUT;              // Set as output mode
-    gpio_conf.pin_bit_mask = (
-        1ULL << SCREEN_CS_PIN | 
-        1ULL << SCREEN_RESET_PIN |
-        1ULL << SCREEN_DC_PIN
-    );                                              // Bit mask of the pins that you want to set, e.g.GPIO18/19
-    gpio_conf.pull_down_en = 0;                     // Disable pull-down mode
-    gpio_conf.pull_up_en = 0;                       // Disable pull-up mode
-    gpio_config(&gpio_conf);
-
-    gpio_set_level(SCREEN_RESET_PIN, 1);
-    vTaskDelay(milliseconds(10));
-
-    dev._model = 0x9341;
-    dev._width = 240;
-    dev._height = 320;
-    dev._offsetx = 0;
-    dev._offsety = 0;
-    dev._font_direction = 0;
-    dev._font_fill = false;
-    dev._font_underline = false;
-
-    spi_device_interface_config_t devcfg={
-        .clock_speed_hz = 60000000,     // Was: SPI_MASTER_FREQ_40M --> (40000000)
-        .spics_io_num = SCREEN_CS_PIN,
-        .queue_size = 7,                // Was 7
-        .flags = SPI_DEVICE_NO_DUMMY
-    };
-
-    ESP_ERROR_CHECK(spi_bus_add_device(HSPI_HOST, &devcfg, &dev._SPIHandle));
-
-    dev._dc = SCREEN_DC_PIN;
-    dev._bl = SLEEP_PIN;
-
-    STATUS("Done with Screen IO!");
-
-    return true;
-}
-
-// Buffer Transmission
-// --------------------
-
-bool sendEntireBuffer()
-{
-    setScreenWriteArea(0, 0, SCREEN_WIDTH-1, SCREEN_HEIGHT-1);
-
-    uint32_t counter = 0;
-
-    for (uint8_t i = 0; i < MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND; ++i)
-    {
-        if (!spi_master_write_bytes_screen((uint8_t*) screenBuffer + counter, SCREEN_MAX_TRANSMISSION_BUFFER)) {
-            ERROR("Could not send colour buffer to screen");
-            return false;
-        }
-        counter += SCREEN_MAX_TRANSMISSION_BUFFER;
-    }
-
-    return true;
-}
-
-bool sendBufferArea(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
-{
-    setScreenWriteArea(x1, y1, x2, y2);
-
-    uint8_t* bufferArea = malloc((x2 - x1 + 1) * (y2 - y1 + 1) * 2);
-
-    if (bufferArea == NULL) {
-        ERROR("Could not allocate temporary buffer area!");
-        DEBUG("Tried to allocate %i and largest free block was %i", ((x2 - x1 + 1) * (y2 - y1 + 1) * 2), heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
-        DEBUG("Coordinates were: %i, %i, %i, %i", x1, y1, x2, y2);
-        return false;
-    }
-
-    for (uint16_t h = 0; h < (y2 - y1); ++h)
-    {
-        memcpy(bufferArea + ((x2 - x1 + 1) * 2 * h), 
-            screenBuffer + ((y1 + h) * SCREEN_WIDTH) + x1, 
-            ((x2 - x1) * 2) + 2);
-    }
-
-
-    uint8_t bufferSegments = (uint8_t)(((x2 - x1) * (y2 - y1) * 2) / 4094) + 1;
-
-    for (uint8_t i = 0; i < bufferSegments; ++i)
-    {
-        spi_master_write_bytes_screen(&bufferArea[(((x2 - x1) * (y2 - y1) * 2) / bufferSegments) * i], ((x2 - x1) * (y2 - y1) * 2) / bufferSegments);
-    }
-
-    /*
-
-    // Check how many MAX_TRANSMISSION needet to send area    
-    if ((x2 - x1) * (y2 - y1) * 2 < 4094) {
-        spi_master_write_bytes_screen(bufferArea, (x2 - x1) * (y2 - y1) * 2);
-    } else if ((x2 - x1) * (y2 - y1) * 2 < 8188) {
-        spi_master_write_bytes_screen(bufferArea, (x2 - x1) * (y2 - y1)); // * 2 / 2 == * 1 
-        spi_master_write_bytes_screen(&bufferArea[(x2 - x1) * (y2 - y1)], (x2 - x1) * (y2 - y1)); // * 2 / 2 == * 1 
-    } else if ((x2 - x1) * (y2 - y1) * 2 < 12282) {
-        spi_master_write_bytes_screen(bufferArea, ((x2 - x1) * (y2 - y1) * 2) / 3); // Send one third of total bytes at the time
-        spi_master_write_bytes_screen(&bufferArea[(((x2 - x1) * (y2 - y1) * 2) / 3) * 1], ((x2 - x1) * (y2 - y1) * 2) / 3); // Start at one third point
-        spi_master_write_bytes_screen(&bufferArea[(((x2 - x1) * (y2 - y1) * 2) / 3) * 2], ((x2 - x1) * (y2 - y1) * 2) / 3); // Start at two thirds point
-    } else if ((x2 - x1) * (y2 - y1) * 2 < 16376) {
-        spi_master_write_bytes_screen(bufferArea, ((x2 - x1) * (y2 - y1) * 2) / 4); // Send one fourth of total bytes at the time
-        spi_master_write_bytes_screen(&bufferArea[(((x2 - x1) * (y2 - y1) * 2) / 4) * 1], ((x2 - x1) * (y2 - y1) * 2) / 4); // Start at one fourth point
-        spi_master_write_bytes_screen(&bufferArea[(((x2 - x1) * (y2 - y1) * 2) / 4) * 2], ((x2 - x1) * (y2 - y1) * 2) / 4); // Start at two fourths point
-        spi_master_write_bytes_screen(&bufferArea[(((x2 - x1) * (y2 - y1) * 2) / 4) * 3], ((x2 - x1) * (y2 - y1) * 2) / 4); // Start at three fourths point
-    } else {
-        // Implement later
-        ERROR("Buffer area this large not implemented... Was %i", (x2 - x1) * (y2 - y1) * 2);
-        return false;
-    }*/
-
-    free(bufferArea);
-    return true;
-}
-
-// Screen display
-// ---------------
-
-bool fillEntireBufferWithColour(uint16_t colour)
-{
-    // Check if colour is black (0x0000) for if so, we can use memset to reset the screen buffer 
-    if (colour == 0x0000) {
-        memset(screenBuffer, 0, SCREEN_BYTES_SIZE);
-    } else {
-        uint16_t correctedColour = reverseBytes(colour);
-        for (uint8_t i = 0; i < SCREEN_BYTES_MEMCPY_NUMBER; ++i)
-        {
-            screenBuffer[i] = correctedColour;
-        }
-        for (uint8_t i = 0; i < SCREEN_BYTES_MEMCPY_EXPONENT; ++i)
-        {
-            memcpy(&screenBuffer[75 * (uint16_t)pow(2, i)], screenBuffer, 75 * (uint16_t)pow(2, i) * 2);
-        }
-    }
-
-    return true;    
-}
-
-bool fillEntireBufferWithImage(struct Image* image) 
-{
-    if (image->width != SCREEN_WIDTH || image->height != SCREEN_HEIGHT) {
-        ERROR("Image does not fit screen!");
-        return false;
-    }
-
-    uint32_t counter = 0;
-
-    for (uint16_t h = 0; h < SCREEN_HEIGHT; ++h)
-    {
-        for(uint16_t w = 0; w < SCREEN_WIDTH; ++w)
-        {
-            screenBuffer[counter] = reverseBytes(image->data[counter]);
-            ++counter;
-        }
-    }
-    return true;
-}
-
-bool fillBufferAreaWithColour(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour)
-{
-     if (x2 > SCREEN_WIDTH || y2 > SCREEN_HEIGHT) {
-        ERROR("Area outside screen bounds");
-        return false;
-    } else if (x1 > x2 || y1 > y2) {
-        ERROR("Invalid buffer area");
-        return false;
-    }
-
-    uint16_t correctedColour = reverseBytes(colour);
-
-    uint32_t counter = (y1 * SCREEN_WIDTH) + x1;
-
-    for (uint16_t h = 0; h < y2 - y1; ++h)
-    {
-        for (uint16_t w = 0; w < x2 - x1; ++w)
-        {
-            screenBuffer[counter] = correctedColour;
-            ++counter;
-        }
-        counter += (SCREEN_WIDTH - (x2 - x1));
-    };
-
-    // Not implemented yet 
-    return true;
-}
-
-bool fillBufferAreaWithImage(uint16_t x1, uint16_t y1, struct Image* image)
-{
-    if (x1 + image->width > SCREEN_WIDTH || y1 + image->height > SCREEN_HEIGHT) {
-        ERROR("Image outside screen bounds");
-        return false;
-    }
-
-    uint32_t counter = (y1 * SCREEN_WIDTH) + x1;
-
-    for (uint16_t h = 0; h < image->height; ++h)
-    {
-        for (uint16_t w = 0; w < image->width; ++w)
-        {
-            screenBuffer[counter] = reverseBytes(image->data[(h * image->width) + w]);
-            ++counter;
-        }
-        counter += (SCREEN_WIDTH - image->width);
-    }
-
-    return true;
-}
-
-bool frameArea(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t frameThickness, uint16_t frameColour, uint16_t areaColour)
-{
-    fillBufferAreaWithColour(x1, y1, x2, y2, areaColour);
-
-    uint16_t width = x2 - x1;
-
-    // Top and bottom
-    // ---------------
-
-    for (uint16_t w = x1; w < x1 + width; ++w)
-    {
-        screenBuffer[(SCREEN_WIDTH * y1) + w] = reverseBytes(frameColour);
-    }
-
-    // Top
-    for (uint16_t h = y1 + 1; h < y1 + frameThickness; ++h)
-    {
-        memcpy(&screenBuffer[(SCREEN_WIDTH * h) + x1], screenBuffer + (SCREEN_WIDTH * y1) + x1, width * 2);
-    }
-
-    // Bottom
-    for (uint16_t h = y2 - frameThickness; h < y2; ++h)
-    {
-        memcpy(&screenBuffer[(SCREEN_WIDTH * h) + x1], screenBuffer + (SCREEN_WIDTH * y1) + x1, width * 2);
-    }
-
-    // Left and Right
-    // ---------------
-
-    for (uint16_t w = 0; w < frameThickness; ++w)
-    {
-        screenBuffer[(SCREEN_WIDTH * (y1 + frameThickness)) + x1 + w] = reverseBytes(frameColour);
-        screenBuffer[(SCREEN_WIDTH * (y1 + frameThickness)) + x1 + width - w - 1] = reverseBytes(frameColour);
-    }
-
-    for (uint16_t h = y1 + frameThickness + 1; h < y2 - frameThickness; ++h)
-    {
-        memcpy(&screenBuffer[(SCREEN_WIDTH * h) + x1], screenBuffer + (SCREEN_WIDTH * (y1 + frameThickness)) + x1, width * 2);
-    }
-
-    return true;
-}
-
-bool writeText(char* text, uint8_t spacing, bool normalizedWidth, struct FontxFile *fx, uint16_t x, uint16_t y, uint16_t textColour)
-{
-    // STATUS("\nWrite text called!\n");
-
-    if (text == NULL) {
-        ERROR("writeText called with empty or unintialized string!");
-        return false;
-    } else if (!fx->opened) {
-        if (!openFont(fx)){
-            LOG_ERROR("Could not open font %s", fx->fontName);
-        }
-    }
-
-    // Colour pre-processing (Only black implemented for now)
-    
-    bool darkText;
-    
-    darkText = (textColour == BLACK);
-
-    // Get mysterious offset - no idea why it is needed
-    uint8_t mysteriousOffset = 18;
-
-    uint16_t charDesiredWidth = 0;
-    if (normalizedWidth) {
-        charDesiredWidth = fx->numbersNormalizedWidth;
-    }
-
-    // Char processing
-    // ----------------
-
-    uint16_t textLenght = strlen(text);
-    uint16_t textWidth = spacing * (textLenght - 1); // Spacing
-    // LOG("Text size: %i", textLenght);
-
-    if (textLenght > WRITE_TEXT_BUFFER) {
-        LOG_ERROR("Text size longer than buffer! Increase buffer from %i to at least %i to write thi text.", WRITE_TEXT_BUFFER, textLenght);
-    }
-
-    CharInfo chars[WRITE_TEXT_BUFFER];
-
-    for (uint16_t c = 0; c < textLenght; ++c)
-    {
-        chars[c].ascii = text[c];
-        getChar(fx, text[c], &chars[c].xPos, &chars[c].width, &chars[c].xOffset);
-        if (normalizedWidth && (chars[c].ascii >= 48 && chars[c].ascii <= 57)) {
-            textWidth += fx->numbersNormalizedWidth;
-        } else {
-            textWidth += chars[c].width;
-        }
-    }
-
-    // Position processing
-    // --------------------
-
-    uint16_t startX = x - (textWidth / 2);
-
-    uint32_t counter = (y * SCREEN_WIDTH) + startX;
-
-    // Plotting into buffer
-    // ---------------------
-
-    // FOR DEBUG
-    //uint8_t debugCounter = 0; 
-
-    for (uint8_t h = 0; h < fx->fontHeight; ++h)
-    {        
-        // Add char data to frame row
-        for (uint16_t c = 0; c < textLenght; ++c)
-        {
-            if (normalizedWidth && (chars[c].ascii >= 48 && chars[c].ascii <= 57) && charDesiredWidth - chars[c].width > 0) {
-                if ((charDesiredWidth - chars[c].width) % 2 == 1) {
-                    counter += ((charDesiredWidth - chars[c].width) / 2) + 1;
-                } else {
-                    counter += (charDesiredWidth - chars[c].width) / 2;
-                }
-            }
-
-            for (uint16_t w = 0; w < chars[c].width; ++w)
-            {
-                uint8_t shade =  fx->charDataPath[(fx->charDataWidth * h) + chars[c].xPos + mysteriousOffset + w];
-
-                if (shade == 0) {
-                    // Do nothing
-                } else if (shade == 255) {
-                    screenBuffer[counter] = reverseBytes(textColour);
-                } else {
-                    uint16_t colour;
-
-                    // Dark colours shade lighter | Light colours shade darker
-                    if (darkText) {
-                        colour = 
-                        // Red
-                        ( ((uint16_t)(((WHITE >> 11) & 0x001F) * (1.0 - (shade / 255.0))) << 11) & 0xF800 ) |
-                        // Green
-                        ( ((uint16_t)(((WHITE >> 5) & 0x003F) * (1.0 - (shade / 255.0))) << 5) & 0x07E0 ) |
-                        // Blue
-                        ( ((uint16_t)(((WHITE >> 0) & 0x001F) * (1.0 - (shade / 255.0))) << 0) & 0x001F );
-                    } else { 
-                        colour = 
-                        // Red
-                        ( ((uint16_t)(((textColour >> 11) & 0x001F) * (shade / 255.0)) << 11) & 0xF800 ) |
-                        // Green
-                        ( ((uint16_t)(((textColour >> 5) & 0x003F) * (shade / 255.0)) << 5) & 0x07E0 ) |
-                        // Blue
-                        ( ((uint16_t)(((textColour >> 0) & 0x001F) * (shade / 255.0)) << 0) & 0x001F );
-                    }
-
-                    // Do not use this debug unless you want some serious masochism...
-                    /*if (debugCounter < 10) {
-
-                        if (darkText) {
-                            DEBUG("Shade %i leads to hex %#04X with %s setting\nFraction: %g\nR: %i --> %g | %i\nG: %i --> %g | %i\nB: %i --> %g | %i\n",
-                                shade, colour, (darkText ? "Dark" : "Light"), (1.0 - (shade / 255.0)), 
-                                ((textColour >> 11) & 0x001F), (((WHITE >> 11) & 0x001F) * (1.0 - (shade / 255.0))), (uint8_t)(((WHITE >> 11) & 0x001F) * (1.0 - (shade / 255.0))), // R
-                                ((textColour >> 5) & 0x003F), (((WHITE >> 5) & 0x003F) * (1.0 - (shade / 255.0))), (uint8_t)(((WHITE >> 5) & 0x003F) * (1.0 - (shade / 255.0))),   // G
-                                ((textColour >> 0) & 0x001F), (((WHITE >> 0) & 0x001F) * (1.0 - (shade / 255.0))), (uint8_t)(((WHITE >> 0) & 0x001F) * (1.0 - (shade / 255.0))) );  // B
-                        } else {
-                            DEBUG("Shade %i leads to hex %#04X with %s setting\nFraction: %g\nR: %i --> %g | %i\nG: %i --> %g | %i\nB: %i --> %g | %i\n",
-                                shade, colour, (darkText ? "Dark" : "Light"), (shade / 255.0), 
-                                ((textColour >> 11) & 0x001F), (((textColour >> 11) & 0x001F) * (shade / 255.0)), (uint8_t)(((textColour >> 11) & 0x001F) * (shade / 255.0)), // R
-                                ((textColour >> 5) & 0x003F), (((textColour >> 5) & 0x003F) * (shade / 255.0)), (uint8_t)(((textColour >> 5) & 0x003F) * (shade / 255.0)),   // G
-                                ((textColour >> 0) & 0x001F), (((textColour >> 0) & 0x001F) * (shade / 255.0)), (uint8_t)(((textColour >> 0) & 0x001F) * (shade / 255.0)) );  // B
-                        }
-                        ++debugCounter;
-                    }*/
-                    screenBuffer[counter] = reverseBytes(colour); // reverseBits
-                }
-                ++counter;
-            }
-
-            if (normalizedWidth && (chars[c].ascii >= 48 && chars[c].ascii <= 57) && charDesiredWidth - chars[c].width > 0) {
-                counter += (charDesiredWidth - chars[c].width) / 2;
-            }
-
-            if (c != textLenght - 1) {
-                counter += spacing;
-            }
-        }
-
-        // Text this!
-        counter += (SCREEN_WIDTH - textWidth);
-    }
-
-    return true;
-}
-
-bool loadingBar(uint16_t centerX, uint16_t centerY, intptr_t variable)
-{
-    //DEBUG("Loading bar called");
-
-    // Hardcoded to black bar for now
-    uint16_t colour = reverseBytes(BLACK);
-    uint16_t light = reverseBytes(BLACK | 0x8410);
-
-    // Hardcoded size for now
-    uint8_t height = 10;
-    uint8_t lenght = 160;
-    uint8_t XPadding = 5;
-    uint8_t YPadding = 4;
-
-    uint8_t angle = height / 3;
-    uint8_t midsection = height - (angle * 2);
-
-    // Determine progress based on linked variable
-    float progress;
-
-    if (variable == (intptr_t)&brewElapsedTime) {
-        progress = (brewElapsedTime / (brewOrder.brewTime * 1000.0));
-        //DEBUG("Progress: %g Elapsed: %i Total: %i", progress, brewElapsedTime, (brewOrder.brewTime * 1000));
-    } else {
-        ERROR("Invalid variable link in loadingBar");
-        return false;
-    }
-    uint8_t pixelProgress = ((lenght * progress) - (angle * 2)) <= 1 ? 2 : (lenght * progress) - (angle * 2);
-
-    uint16_t topLeftX = centerX - (uint16_t)(loadingBarBackground.width / 2);
-    uint16_t topLeftY = centerY - (uint16_t)(loadingBarBackground.height / 2);
-
-    // Fill buffer with bar background
-    fillBufferAreaWithImage(topLeftX, topLeftY, &loadingBarBackground);
-
-    // Plot bar on buffer
-    // -------------------
-
-    // Top section
-    for (uint8_t h = 0; h < angle; ++h)
-    {
-        if (h == angle / 2) {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle - h - 1] = colour;
-        } else {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle - h - 1] = light;
-        }
-
-        for (uint8_t l = angle - h; l < angle + pixelProgress + h; ++l)
-        {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + l] = colour;            
-        }                             
-
-        if (h == angle / 2) {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle + pixelProgress + h] = colour;       // Bytes flipped on | 0xXXXX number
-        } else {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle + pixelProgress + h] = light;       // Bytes flipped on | 0xXXXX number
-        }
-    }
-
-    // DEBUG("Done with top section");
-
-    // Middle section
-    for (uint8_t h = angle; h < midsection + angle; ++h)
-    {
-        for (uint8_t l = 0; l < pixelProgress + (angle * 2); ++l)
-        {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + l] = colour;
-        }
-    }
-
-    //DEBUG("Done with Midddle section");
-
-    // Bottom section
-    for (uint8_t h = midsection + angle; h < (angle * 2) + midsection; ++h)
-    {
-        if (h == angle + midsection + (angle / 2)) {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle - (height - h)] = colour;   // Bytes flipped on | 0xXXXX number
-        } else {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle - (height - h)] = light;   // Bytes flipped on | 0xXXXX number
-        }
-
-        for (uint8_t l = angle - (height- 1 - h); l < angle + pixelProgress + (height - 1 - h); ++l)
-        {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + l] = colour;
-        }
-
-        if (h == angle + midsection + (angle / 2)) {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle + pixelProgress + (height - h - 1)] = colour;    // Bytes flipped on | 0xXXXX number
-        } else {
-            screenBuffer[((topLeftY + YPadding + h) * SCREEN_WIDTH) + topLeftX + XPadding + angle + pixelProgress + (height - h - 1)] = light;  // Bytes flipped on | 0xXXXX number
-        }
-    }
-
-    // DEBUG("Done with Bottom section");
-
-    // Send buffer area
-    if (!sendBufferArea(topLeftX, topLeftY, topLeftX + loadingBarBackground.width, topLeftY + loadingBarBackground.height)) {
-        ERROR("Could not send buffer to screen");
-        return false;
-    }
-    return true;
-}
-
-bool brewingAnimation(uint16_t centerX, uint16_t centerY, uint8_t stage)
-{
-    // uint8_t y_drop_limit;
-
-    // How many stages? (Frame)
-
-    // Calculate where to place drop based on stage
-
-    // Load static machine and cup image
-
-    return true;
-}
-
-bool processLoadingCircle(uint16_t centerX, uint16_t centerY, intptr_t variable)
-{
-    ERROR("processLoadingCircle() not implemented!");
-
-    // Diameter 120
-
-    /*
-
-            •  •              
-         •        •        
-        •          •      
-        •          •      
-         •        •        
-            •  •  
-
-    */
-
-    return false;
-}
-
-bool barAdjuster(uint16_t centerX, uint16_t centerY, intptr_t variable)
-{
-    uint8_t numberOfBars;
-    uint8_t activeBars;
-    uint8_t barWidth;
-    uint8_t barHeight;
-    uint8_t barSpacing;
-    uint8_t topY;
-    uint8_t leftX;
-
-    if (variable == getCalibrationValue(BUTTONS)) {
-        numberOfBars = 8;
-        activeBars = getCalibrationValue(BUTTONS) + 1;
-        barWidth = 100;
-        barHeight = 8;
-        barSpacing = 12;
-    } else {
-        ERROR("Invalid or unimplemented variable in barAdjuster");
-        return false;
-    }
-
-    leftX = centerX - (barWidth / 2);
-    topY = centerY - (((numberOfBars * barHeight) + (barSpacing * (numberOfBars - 1))) / 2);
-
-    for (uint8_t b = 0; b < numberOfBars; ++b)
-    {
-        if (numberOfBars - b <= activeBars) {
-            fillBufferAreaWithColour(leftX, topY + (b * (barHeight + barSpacing)), leftX + barWidth, topY + (b * (barHeight + barSpacing)) + barHeight, WHITE);
-        } else {
-            fillBufferAreaWithColour(leftX, topY + (b * (barHeight + barSpacing)), leftX + barWidth, topY + (b * (barHeight + barSpacing)) + barHeight, BLACK);
-        }
-    }
-
-    // DEBUG("Variables:\n\t* leftX: %i\n\t* topY: %i\n\t* bottomY: %i\n\t* bottomY: %i", leftX, topY, leftX + barWidth, topY + ((numberOfBars * barHeight) + (barSpacing * (numberOfBars - 1))));
-
-    return sendBufferArea(leftX, topY, leftX + barWidth, topY + ((numberOfBars * barHeight) + (barSpacing * (numberOfBars - 1))));
-}
-
-
-// ----------------------------------------------
-//                    OLD CODE
-// ----------------------------------------------
-
-/*bool sendBytes(TFT_t* dev, DataOrCommand doc, uint8_t* buffer, uint16_t size)
-{
-    // DC pin should by default in DATA mode, and changed to COMMAND only while sending, and then reset!
-
-    if (doc == COMMAND) { 
-        gpio_set_level(dev->_dc, COMMAND)
-        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
-            gpio_set_level(dev->_dc, DATA)
-            return true;
-        } else {
-            ERROR("Could not write 8 bit data to ILI9341 screen!");
-            gpio_set_level(dev->_dc, DATA);
-            return false;
-        }
-    } else {
-        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
-            return true;
-        } else {
-            ERROR("Could not write 8 bit data to ILI9341 screen!");
-            return false
-        }
-    }
-}*/
-
-
-/*bool send16bits(TFT_t* dev, DataOrCommand doc, uint16_t* buffer, uint16_t size)
-{
-    // DC pin should by default in DATA mode, and changed to COMMAND only while sending, and then reset!
-
-    if (doc == COMMAND) { 
-        gpio_set_level(dev->_dc, COMMAND)
-            // UNREVERSED BUFFER !!!
-        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
-            gpio_set_level(dev->_dc, DATA)
-            return true;
-        } else {
-            ERROR("Could not write 8 bit data to ILI9341 screen!");
-            gpio_set_level(dev->_dc, DATA);
-            return false;
-        }
-    } else {
-            // UNREVERSED BUFFER !!!
-        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
-            return true;
-        } else {
-            ERROR("Could not write 8 bit data to ILI9341 screen!");
-            return false
-        }
-    }
+#include <freertos/FreeRTOS.h>
+#include <driver/spi_master.h>
+#include <global_variables.h>
+#include <freertos/task.h>
+#include <driver/gpio.h>
+#include <esp_attr.h>
+#include <esp_timer.h>
+#include <esp_rom_sys.h>
+#include <settings.h>
+#include <colours.h>
+#include <ili9341_kernels.h>
+#include <ili9341_trace.h>
+#include <ili9341.h>
+#include <string.h>
+#include <images.h>
+#include <fonts.h>
+#ifdef SCREEN_PERF_COUNTERS
+#include <esp_cpu.h>
+#endif
+
+// #include <esp_heap_caps.h>
+
+#if defined(SCREEN_STRIP_RENDERER) && defined(SCREEN_INDEXED_FRAMEBUFFER)
+#error "SCREEN_STRIP_RENDERER and SCREEN_INDEXED_FRAMEBUFFER cannot be combined"
+#endif
+
+// Buffer of the screen set up without a config, wired as in pinmap.h
+#if defined(SCREEN_INDEXED_FRAMEBUFFER)
+static uint8_t screenBuffer[SCREEN_PIXELS_SIZE]; // Palette indices
+#elif !defined(SCREEN_STRIP_RENDERER)
+static uint16_t screenBuffer[SCREEN_PIXELS_SIZE]; // [SCREEN_HEIGHT * SCREEN_WIDTH]
+#endif
+static ScreenBus defaultBus = { .host = HSPI_HOST };
+static bool screenBufferTaken = false;
+
+// Transaction flags, carried in the low bits of the user field next to the screen and read back in the SPI callbacks.
+// The D/C level is bit 0.
+#define TRANSACTION_DATA        0x01
+#define TRANSACTION_SIGNAL_DONE 0x02
+#define TRANSACTION_FLAGS       0x03
+
+static inline void* transactionUser(TFT_t* dev, uint32_t flags)
+{
+    return (void*)((uintptr_t)dev | flags);
+}
+
+static inline TFT_t* transactionScreen(const spi_transaction_t* transaction)
+{
+    return (TFT_t*)((uintptr_t)transaction->user & ~(uintptr_t)TRANSACTION_FLAGS);
+}
+
+#if defined(SCREEN_STRIP_RENDERER) || defined(SCREEN_INDEXED_FRAMEBUFFER)
+#define STRIP_PIXELS SCREEN_STRIP_BUFFER_PIXELS
+#define COMMAND_STAGING(dev) ((uint8_t*)(dev)->_stripBuffers[0])
+#else
+#define COMMAND_STAGING(dev) ((dev)->_stagingBuffers[0])
+#endif
+
+// Where rasterisation lands: all of the screen buffer, or one strip of the screen in strip renderer and indexed modes
+typedef struct RenderTarget {
+    uint16_t* pixels;
+    ScreenArea area;        // Screen area covered by pixels
+    uint16_t width;         // Row stride in pixels
+} RenderTarget;
+
+#if defined(SCREEN_INDEXED_FRAMEBUFFER)
+// Palette in wire order, the nearest entry for every colour cut down to 4 bits per channel, and an open addressed
+// table of the exact colours, so a colour that is not in the palette is told apart without scanning it
+#define PALETTE_EXACT_SLOTS 512
+#define PALETTE_EXACT_EMPTY 0xFFFF
+static uint16_t screenPalette[256];
+static uint16_t screenPaletteSize = 0;
+static uint8_t paletteLookup[4096];
+static uint16_t paletteExact[PALETTE_EXACT_SLOTS];
+#endif
+
+// Drawing front ends, which record into the display list. Areas are inclusive, colours for fills are in wire order.
+static bool drawFill(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t wireColour);
+static bool drawImage(TFT_t* dev, uint16_t x, uint16_t y, const struct Image* image);
+static bool drawImagePart(TFT_t* dev, const ScreenArea* area, uint16_t x, uint16_t y, const struct Image* image);
+static bool drawCompressedImage(TFT_t* dev, uint16_t x, uint16_t y, const CompressedImage* image);
+static bool drawIndexedImage(TFT_t* dev, uint16_t x, uint16_t y, const IndexedImage* image);
+static bool drawGlyph(TFT_t* dev, struct FontxFile* fx, const CharInfo* glyph, uint16_t x, uint16_t y, uint16_t textColour);
+static bool drawArc(TFT_t* dev, uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t startAngle, uint16_t sweep, uint16_t wireColour, uint8_t flags, uint16_t wireBackground);
+
+#if defined(SCREEN_STRIP_RENDERER) || defined(SCREEN_INDEXED_FRAMEBUFFER)
+static bool sendAreaInStrips(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t lastFlags);
+#endif
+static bool transmitBufferArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+static bool transmitBufferRows(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+#ifndef SCREEN_STRIP_RENDERER
+static void resolveDisplayList(TFT_t* dev);
+static void discardDisplayList(TFT_t* dev);
+#endif
+static void forgetDirtyAreasInside(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+
+// Performance counters
+// ---------------------
+
+// Without SCREEN_PERF_COUNTERS these do nothing, and the compiler drops them along with the timestamps passed in
+#ifdef SCREEN_PERF_COUNTERS
+static inline uint32_t perfNow()
+{
+    return esp_cpu_get_cycle_count();
+}
+
+static inline void perfCountTransaction(TFT_t* dev, uint32_t bytes)
+{
+    ++dev->_perf.transactions;
+    dev->_perf.bytes += bytes;
+}
+
+// Starts timing a call, unless it was made from inside another one that is timed already
+static inline bool perfBeginCall(TFT_t* dev, ScreenPerfCall call)
+{
+    if (dev->_perfCall != SCREEN_PERF_OTHER) {
+        return false;
+    }
+    dev->_perfCall = call;
+    dev->_perfCallStart = perfNow();
+    return true;
+}
+
+static void perfEndCall(TFT_t* dev, bool outermost, bool frame)
+{
+    if (!outermost) {
+        return;
+    }
+
+    uint32_t cycles = perfNow() - dev->_perfCallStart;
+    ScreenPerfCallStats* stats = &dev->_perf.calls[dev->_perfCall];
+
+    ++stats->calls;
+    stats->totalCycles += cycles;
+
+    if (frame) {
+        uint32_t bucket = cycles / (dev->_perf.cyclesPerUs * SCREEN_PERF_BUCKET_US);
+        ++dev->_perf.frameTimes[(bucket < SCREEN_PERF_HISTOGRAM_BUCKETS) ? bucket : SCREEN_PERF_HISTOGRAM_BUCKETS - 1];
+    }
+    dev->_perfCall = SCREEN_PERF_OTHER;
+}
+
+static inline void perfAddRasterise(TFT_t* dev, uint32_t start)
+{
+    dev->_perf.calls[dev->_perfCall].rasteriseCycles += perfNow() - start;
+}
+
+static inline void perfAddSpiWait(TFT_t* dev, uint32_t start)
+{
+    dev->_perf.calls[dev->_perfCall].spiWaitCycles += perfNow() - start;
+}
+
+void getScreenPerfCounters(TFT_t* dev, ScreenPerfCounters* counters)
+{
+    *counters = dev->_perf;
+}
+
+void resetScreenPerfCounters(TFT_t* dev)
+{
+    memset(&dev->_perf, 0, sizeof(ScreenPerfCounters));
+    dev->_perf.cyclesPerUs = esp_rom_get_cpu_ticks_per_us();
+}
+#else
+static inline uint32_t perfNow() { return 0; }
+static inline void perfCountTransaction(TFT_t* dev, uint32_t bytes) {}
+static inline bool perfBeginCall(TFT_t* dev, ScreenPerfCall call) { return false; }
+static inline void perfEndCall(TFT_t* dev, bool outermost, bool frame) {}
+static inline void perfAddRasterise(TFT_t* dev, uint32_t start) {}
+static inline void perfAddSpiWait(TFT_t* dev, uint32_t start) {}
+#endif
+
+// SPI transmission functions
+// ---------------------------
+
+// D/C is driven from the transaction itself, so commands and data can sit in the queue together
+static void IRAM_ATTR screenTransactionStart(spi_transaction_t* transaction)
+{
+    gpio_set_level(transactionScreen(transaction)->_dc, (uintptr_t)transaction->user & TRANSACTION_DATA);
+}
+
+static void IRAM_ATTR screenTransactionDone(spi_transaction_t* transaction)
+{
+    if ((uintptr_t)transaction->user & TRANSACTION_SIGNAL_DONE) {
+        TFT_t* dev = transactionScreen(transaction);
+
+        dev->_transmissionDone = true;
+        if (dev->_onTransmissionDone != NULL) {
+            dev->_onTransmissionDone(dev->_onTransmissionDoneArg);
+        }
+    }
+}
+
+#ifdef SCREEN_SPI_TRACE
+static void traceTransaction(TFT_t* dev, SpiTraceKind kind, const spi_transaction_t* transaction)
+{
+    const uint8_t* bytes = (transaction->flags & SPI_TRANS_USE_TXDATA) ? transaction->tx_data : transaction->tx_buffer;
+
+    recordSpiTransaction((dev->_cs >= 0) ? dev->_cs : 0xFF, kind, (uintptr_t)transaction->user & TRANSACTION_DATA, bytes, transaction->length / 8);
+}
+#else
+static inline void traceTransaction(TFT_t* dev, SpiTraceKind kind, const spi_transaction_t* transaction) {}
+#endif
+
+// Bus scheduling
+// ---------------
+
+// Every screen counts the bytes it queues. A screen starting to send after a pause joins at the count of the furthest
+// behind screen already sending, so it neither owes the others for the pause nor gets to make up for it. Screens may
+// be driven from different tasks, so the counts of the others are read atomically.
+static uint32_t slowestOtherScreen(TFT_t* dev, uint8_t* sending)
+{
+    uint32_t slowest = dev->_busBytes;
+    bool found = false;
+
+    *sending = 1;
+
+    for (uint8_t i = 0; i < dev->_bus->screenCount; ++i)
+    {
+        TFT_t* other = dev->_bus->screens[i];
+
+        if (other != dev && __atomic_load_n(&other->_busActive, __ATOMIC_RELAXED)) {
+            uint32_t bytes = __atomic_load_n(&other->_busBytes, __ATOMIC_RELAXED);
+
+            if (!found || (int32_t)(bytes - slowest) < 0) {
+                slowest = bytes;
+                found = true;
+            }
+            ++*sending;
+        }
+    }
+    return slowest;
+}
+
+static bool collectOneTransaction(TFT_t* dev)
+{
+    spi_transaction_t* transaction;
+    uint32_t waitStart = perfNow();
+
+    if (spi_device_get_trans_result(dev->_SPIHandle, &transaction, portMAX_DELAY) != ESP_OK) {
+        ERROR("Could not get queued transaction result from screen!");
+        return false;
+    }
+    perfAddSpiWait(dev, waitStart);
+
+    if (--dev->_transactionsInFlight == 0) {
+        __atomic_store_n(&dev->_busActive, false, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+// Waits until the screen may queue more. With other screens sending, it keeps no more than its share of the queue
+// slots, and lets its own queue drain while it is a quantum ahead of any of them. A device with nothing queued is
+// passed over by the SPI driver, so the others get the bus whichever order the driver serves devices in.
+static bool waitForBusTurn(TFT_t* dev)
+{
+    uint8_t sending;
+
+    if (!dev->_busActive) {
+        __atomic_store_n(&dev->_busBytes, slowestOtherScreen(dev, &sending), __ATOMIC_RELAXED);
+        __atomic_store_n(&dev->_busActive, true, __ATOMIC_RELAXED);
+    }
+
+    while (dev->_transactionsInFlight > 0) {
+        uint32_t slowest = slowestOtherScreen(dev, &sending);
+        uint8_t share = SCREEN_SPI_QUEUE_SIZE / sending;
+
+        if (dev->_transactionsInFlight < share && (int32_t)(dev->_busBytes - slowest) <= SCREEN_BUS_QUANTUM) {
+            break;
+        }
+        if (!collectOneTransaction(dev)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool queueTransaction(TFT_t* dev, spi_transaction_t* transaction)
+{
+    if (!waitForBusTurn(dev)) {
+        return false;
+    }
+
+    traceTransaction(dev, SPI_TRACE_QUEUED, transaction);
+
+    if (spi_device_queue_trans(dev->_SPIHandle, transaction, portMAX_DELAY) != ESP_OK) {
+        return false;
+    }
+    ++dev->_transactionsInFlight;
+    __atomic_store_n(&dev->_busBytes, dev->_busBytes + (transaction->length / 8), __ATOMIC_RELAXED);
+    perfCountTransaction(dev, transaction->length / 8);
+    return true;
+}
+
+bool queueBytesToScreen(TFT_t* dev, spi_transaction_t* transaction, const uint8_t* data, size_t dataLength, uint32_t flags)
+{
+    memset(transaction, 0, sizeof(spi_transaction_t));
+    transaction->length = dataLength * 8;
+    transaction->tx_buffer = data;
+    transaction->user = transactionUser(dev, flags | TRANSACTION_DATA);
+
+    if (!queueTransaction(dev, transaction)) {
+        ERROR("Could not queue transaction to screen!");
+        return false;
+    }
+    return true;
+}
+
+bool queueCommandToScreen(TFT_t* dev, spi_transaction_t* transaction, uint8_t command)
+{
+    memset(transaction, 0, sizeof(spi_transaction_t));
+    transaction->flags = SPI_TRANS_USE_TXDATA;
+    transaction->length = 8;
+    transaction->tx_data[0] = command;
+    transaction->user = transactionUser(dev, COMMAND);
+
+    if (!queueTransaction(dev, transaction)) {
+        ERROR("Could not queue command %#04X to screen!", command);
+        return false;
+    }
+    return true;
+}
+
+// Collect finished transactions until no more than keepInFlight remain queued
+static bool collectTransactions(TFT_t* dev, uint8_t keepInFlight)
+{
+    while (dev->_transactionsInFlight > keepInFlight) {
+        if (!collectOneTransaction(dev)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool waitForTransmission(TFT_t* dev)
+{
+    return collectTransactions(dev, 0);
+}
+
+bool isTransmissionDone(TFT_t* dev)
+{
+    return dev->_transmissionDone;
+}
+
+bool spi_master_write_bytes_screen(TFT_t* dev, const uint8_t* data, size_t dataLength)
+{
+    spi_transaction_t SPITransaction;
+
+    // Blocking transactions may not be mixed with queued ones still in flight
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+    if ( dataLength > 0 ) {
+        memset( &SPITransaction, 0, sizeof(spi_transaction_t) );
+        SPITransaction.length = dataLength * 8;
+        SPITransaction.tx_buffer = data;
+        SPITransaction.user = transactionUser(dev, TRANSACTION_DATA);
+
+        traceTransaction(dev, SPI_TRACE_BLOCKING, &SPITransaction);
+
+        uint32_t waitStart = perfNow();
+        bool sent = spi_device_transmit(dev->_SPIHandle, &SPITransaction) == ESP_OK;
+
+        perfAddSpiWait(dev, waitStart);
+        perfCountTransaction(dev, dataLength);
+        return sent;
+    }
+    ERROR("Tried to send 0 bytes to screen!");
+    return false;
+}
+
+bool sendByte(TFT_t* dev, DataOrCommand doc, uint8_t byte)
+{
+    spi_transaction_t SPITransaction;
+
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+    // D/C follows the transaction through screenTransactionStart
+    memset( &SPITransaction, 0, sizeof(spi_transaction_t) );
+    SPITransaction.flags = SPI_TRANS_USE_TXDATA;
+    SPITransaction.length = 8;
+    SPITransaction.tx_data[0] = byte;
+    SPITransaction.user = transactionUser(dev, doc);
+    traceTransaction(dev, SPI_TRACE_BLOCKING, &SPITransaction);
+
+    uint32_t waitStart = perfNow();
+
+    if (spi_device_transmit(dev->_SPIHandle, &SPITransaction) != ESP_OK) {
+        ERROR("Could not write 8 bit %s to ILI9341 screen!", (doc == COMMAND) ? "command" : "data");
+        return false;
+    }
+    perfAddSpiWait(dev, waitStart);
+    perfCountTransaction(dev, 1);
+    return true;
+}
+
+// Utility
+// --------
+
+// Command and its arguments as polling transactions, which skip the interrupt round trip of a queued one. Up to four
+// arguments travel inside the transaction itself.
+bool pollCommandToScreen(TFT_t* dev, uint8_t command, const uint8_t* arguments, uint8_t argumentCount)
+{
+    spi_transaction_t SPITransaction;
+
+    memset( &SPITransaction, 0, sizeof(spi_transaction_t) );
+    SPITransaction.flags = SPI_TRANS_USE_TXDATA;
+    SPITransaction.length = 8;
+    SPITransaction.tx_data[0] = command;
+    SPITransaction.user = transactionUser(dev, COMMAND);
+
+    traceTransaction(dev, SPI_TRACE_POLLING, &SPITransaction);
+
+    uint32_t waitStart = perfNow();
+
+    if (spi_device_polling_transmit(dev->_SPIHandle, &SPITransaction) != ESP_OK) {
+        return false;
+    }
+    perfCountTransaction(dev, 1);
+
+    if (argumentCount > 0) {
+        SPITransaction.length = argumentCount * 8;
+        SPITransaction.user = transactionUser(dev, TRANSACTION_DATA);
+
+        if (argumentCount <= 4) {
+            memcpy(SPITransaction.tx_data, arguments, argumentCount);
+        } else {
+            SPITransaction.flags = 0;
+            SPITransaction.tx_buffer = arguments;
+        }
+        traceTransaction(dev, SPI_TRACE_POLLING, &SPITransaction);
+
+        if (spi_device_polling_transmit(dev->_SPIHandle, &SPITransaction) != ESP_OK) {
+            return false;
+        }
+        perfCountTransaction(dev, argumentCount);
+    }
+    perfAddSpiWait(dev, waitStart);
+    return true;
+}
+
+void invalidateScreenWriteArea(TFT_t* dev)
+{
+    dev->_windowValid = false;
+}
+
+bool setScreenWriteArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    uint8_t data[4];
+
+    // Polling transactions may not be mixed with queued ones still in flight
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+#ifdef SCREEN_PERF_COUNTERS
+    ++dev->_perf.windowSetups;
+#endif
+
+    // RAMWR restarts at the window origin, so an unchanged column or page range does not need to be sent again
+    if (!dev->_windowValid || dev->_window.x1 != x1 || dev->_window.x2 != x2) {
+        data[0] = (x1 >> 8) & 0xFF;
+        data[1] = x1 & 0xFF;
+        data[2] = (x2 >> 8) & 0xFF;
+        data[3] = x2 & 0xFF;
+        if (!pollCommandToScreen(dev, ILI9341_COLUMN_ADDR, data, 4)) {
+            ERROR("Could not set column adress on screen");
+            dev->_windowValid = false;
+            return false;
+        }
+#ifdef SCREEN_PERF_COUNTERS
+        ++dev->_perf.addressCommands;
+#endif
+    }
+
+    if (!dev->_windowValid || dev->_window.y1 != y1 || dev->_window.y2 != y2) {
+        data[0] = (y1 >> 8) & 0xFF;
+        data[1] = y1 & 0xFF;
+        data[2] = (y2 >> 8) & 0xFF;
+        data[3] = y2 & 0xFF;
+        if (!pollCommandToScreen(dev, ILI9341_PAGE_ADDR, data, 4)) {
+            ERROR("Could not set page adress on screen");
+            dev->_windowValid = false;
+            return false;
+        }
+#ifdef SCREEN_PERF_COUNTERS
+        ++dev->_perf.addressCommands;
+#endif
+    }
+
+    dev->_window.x1 = x1;
+    dev->_window.y1 = y1;
+    dev->_window.x2 = x2;
+    dev->_window.y2 = y2;
+    dev->_windowValid = true;
+
+    if (!pollCommandToScreen(dev, ILI9341_WRITE_RAM, NULL, 0)) {
+        ERROR("Could not start memory write on screen");
+        return false;
+    }
+    return true;
+}
+
+uint16_t reverseBytes(uint16_t num)
+{
+    return (((num & 0xff00) >> 8) | ((num & 0x00ff) << 8));
+}
+
+// Colours from the public API, which are in wire order already when built with SCREEN_WIRE_ORDER
+static inline uint16_t toWireColour(uint16_t colour)
+{
+#ifdef SCREEN_WIRE_ORDER
+    return colour;
+#else
+    return reverseBytes(colour);
+#endif
+}
+
+static inline uint16_t toNativeColour(uint16_t colour)
+{
+#ifdef SCREEN_WIRE_ORDER
+    return reverseBytes(colour);
+#else
+    return colour;
+#endif
+}
+
+// RGB565 spread as -----GGGGGG-----RRRRR------BBBBB, leaving room for each channel to be scaled by up to 32
+static inline uint32_t expandColour(uint16_t colour)
+{
+    return ((colour | ((uint32_t)colour << 16)) & 0x07E0F81F);
+}
+
+static inline uint16_t compactColour(uint32_t expanded)
+{
+    expanded &= 0x07E0F81F;
+    return (uint16_t)(expanded | (expanded >> 16));
+}
+
+// Rasterisation
+// --------------
+
+static inline uint16_t* targetPixel(const RenderTarget* target, uint16_t x, uint16_t y)
+{
+    return &target->pixels[((y - target->area.y1) * target->width) + (x - target->area.x1)];
+}
+
+// Clips an inclusive area to the target, returning false when nothing is left
+static bool clipToTarget(const RenderTarget* target, ScreenArea* area)
+{
+    if (area->x1 > target->area.x2 || area->x2 < target->area.x1 || area->y1 > target->area.y2 || area->y2 < target->area.y1) {
+        return false;
+    }
+
+    area->x1 = area->x1 < target->area.x1 ? target->area.x1 : area->x1;
+    area->y1 = area->y1 < target->area.y1 ? target->area.y1 : area->y1;
+    area->x2 = area->x2 > target->area.x2 ? target->area.x2 : area->x2;
+    area->y2 = area->y2 > target->area.y2 ? target->area.y2 : area->y2;
+    return true;
+}
+
+static void rasteriseFill(const RenderTarget* target, ScreenArea area, uint16_t wireColour)
+{
+    if (!clipToTarget(target, &area)) {
+        return;
+    }
+
+    for (uint16_t h = area.y1; h <= area.y2; ++h)
+    {
+        spanFill(targetPixel(target, area.x1, h), wireColour, area.x2 - area.x1 + 1);
+    }
+}
+
+// Draws the part of image inside area, with the whole image at x, y
+static void rasteriseImagePart(const RenderTarget* target, ScreenArea area, uint16_t x, uint16_t y, const struct Image* image)
+{
+    if (!clipToTarget(target, &area)) {
+        return;
+    }
+
+    for (uint16_t h = area.y1; h <= area.y2; ++h)
+    {
+#ifdef SCREEN_WIRE_ORDER
+        spanCopy(targetPixel(target, area.x1, h), &image->data[((h - y) * image->width) + (area.x1 - x)], area.x2 - area.x1 + 1);
+#else
+        spanCopySwap(targetPixel(target, area.x1, h), &image->data[((h - y) * image->width) + (area.x1 - x)], area.x2 - area.x1 + 1);
+#endif
+    }
+}
+
+static inline void rasteriseImage(const RenderTarget* target, uint16_t x, uint16_t y, const struct Image* image)
+{
+    ScreenArea area = { x, y, x + image->width - 1, y + image->height - 1 };
+    rasteriseImagePart(target, area, x, y, image);
+}
+
+static inline uint8_t indexedPixel(const uint8_t* row, uint16_t column, uint8_t bitsPerPixel)
+{
+    uint16_t bit = column * bitsPerPixel;
+    return (row[bit >> 3] >> (8 - bitsPerPixel - (bit & 7))) & ((1 << bitsPerPixel) - 1);
+}
+
+static void rasteriseIndexedImage(const RenderTarget* target, uint16_t x, uint16_t y, const IndexedImage* image)
+{
+    ScreenArea area = { x, y, x + image->width - 1, y + image->height - 1 };
+
+    if (!clipToTarget(target, &area)) {
+        return;
+    }
+
+    const uint16_t* palette = image->palette;
+    uint8_t bitsPerPixel = image->bitsPerPixel;
+    uint32_t stride = ((uint32_t)image->width * bitsPerPixel + 7) / 8;
+    uint16_t left = area.x1 - x;
+    uint16_t right = area.x2 - x;
+
+    for (uint16_t h = area.y1; h <= area.y2; ++h)
+    {
+        const uint8_t* source = image->data + ((h - y) * stride);
+        uint16_t* row = targetPixel(target, area.x1, h);
+        uint16_t column = left;
+
+        if (image->transparentIndex != INDEXED_IMAGE_OPAQUE) {
+            for (; column <= right; ++column, ++row)
+            {
+                uint8_t index = indexedPixel(source, column, bitsPerPixel);
+
+                if (index != image->transparentIndex) {
+                    *row = palette[index];
+                }
+            }
+            continue;
+        }
+
+        // Line up on a word, then expand two pixels per store
+        if (((uintptr_t)row & 2) && column <= right) {
+            *row++ = palette[indexedPixel(source, column++, bitsPerPixel)];
+        }
+
+        if (bitsPerPixel == 8) {
+            for (; column + 1 <= right; column += 2, row += 2)
+            {
+                *(PixelPair*)row = palette[source[column]] | ((uint32_t)palette[source[column + 1]] << 16);
+            }
+        } else {
+            for (; column + 1 <= right; column += 2, row += 2)
+            {
+                *(PixelPair*)row = palette[indexedPixel(source, column, bitsPerPixel)] | ((uint32_t)palette[indexedPixel(source, column + 1, bitsPerPixel)] << 16);
+            }
+        }
+
+        if (column <= right) {
+            *row = palette[indexedPixel(source, column, bitsPerPixel)];
+        }
+    }
+}
+
+// Returns where the row after the next rows rows of compressed data starts
+static const uint8_t* skipCompressedRows(const uint8_t* data, uint16_t width, uint16_t rows)
+{
+    for (uint16_t r = 0; r < rows; ++r)
+    {
+        for (uint16_t column = 0; column < width;)
+        {
+            uint16_t count = (*data & COMPRESSED_IMAGE_COUNT_MASK) + 1;
+
+            data += (*data & COMPRESSED_IMAGE_LITERAL) ? 1 + (count * 2) : 3;
+            column += count;
+        }
+    }
+    return data;
+}
+
+// Decodes only the rows inside the target, starting from the closest indexed row above them
+static void rasteriseCompressedImage(const RenderTarget* target, uint16_t x, uint16_t y, const CompressedImage* image)
+{
+    ScreenArea area = { x, y, x + image->width - 1, y + image->height - 1 };
+
+    if (!clipToTarget(target, &area)) {
+        return;
+    }
+
+    uint16_t firstRow = area.y1 - y;
+    uint16_t indexEntry = firstRow / image->indexRows;
+    const uint8_t* data = skipCompressedRows(image->data + image->rowIndex[indexEntry], image->width, firstRow - (indexEntry * image->indexRows));
+
+    // Image columns that land inside the target
+    uint16_t left = area.x1 - x;
+    uint16_t right = area.x2 - x;
+
+    for (uint16_t h = area.y1; h <= area.y2; ++h)
+    {
+        uint16_t* row = targetPixel(target, area.x1, h);
+
+        for (uint16_t column = 0; column < image->width;)
+        {
+            uint8_t tag = *data++;
+            uint16_t count = (tag & COMPRESSED_IMAGE_COUNT_MASK) + 1;
+            uint16_t start = column > left ? column : left;
+            uint16_t end = (column + count - 1) < right ? (column + count - 1) : right;
+
+            if (tag & COMPRESSED_IMAGE_LITERAL) {
+                if (start <= end) {
+                    memcpy(&row[start - left], data + ((start - column) * 2), (end - start + 1) * 2);
+                }
+                data += count * 2;
+            } else {
+                uint16_t wireColour;
+
+                // Stored high byte first, which already is wire order in memory
+                memcpy(&wireColour, data, 2);
+                if (start <= end) {
+                    spanFill(&row[start - left], wireColour, end - start + 1);
+                }
+                data += 2;
+            }
+            column += count;
+        }
+    }
+}
+
+// Arcs. Rings are drawn from span tables that give, for every row out from the centre, how far the circle reaches
+// either side. Each table is built with an integer midpoint walk over one octant and mirrored into the other, and each
+// screen keeps the tables of the last ring it drew. Only the pixels along the two edges need their coverage worked out,
+// from their squared distance, and straight edges are not anti-aliased, so sectors drawn next to each other tile exactly.
+
+#define ARC_OVER_BACKGROUND 0x01    // Edges blend with arcBackground rather than the pixels under them
+#define ARC_SINE_SHIFT 14
+
+// Sines of whole degrees from 0 to 90, scaled by 1 << ARC_SINE_SHIFT
+static const uint16_t arcSines[91] = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563, 2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+    5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943, 8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087,
+    10311, 10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365, 12551, 12733, 12911, 13085, 13255,
+    13421, 13583, 13741, 13894, 14044, 14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296, 15396,
+    15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083, 16135, 16182, 16225, 16262, 16294, 16322, 16344,
+    16362, 16374, 16382, 16384
+};
+
+static uint32_t integerSquareRoot(uint32_t value)
+{
+    uint32_t root = 0;
+
+    for (uint32_t bit = 1u << 30; bit > 0; bit >>= 2)
+    {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+static void buildArcSpanTable(ArcSpanTable* table, uint32_t bound)
+{
+    uint32_t x = integerSquareRoot(bound);
+    uint32_t y = 0;
+    int32_t slack = bound - (x * x);    // bound - (x * x + y * y), kept from going negative
+
+    table->rows = x;
+
+    // First octant, from the centre row up to the diagonal
+    while (y <= x) {
+        table->halfWidth[y] = x;
+        ++y;
+        slack -= (2 * y) - 1;
+
+        while (slack < 0 && x >= y) {
+            // Column y is outside on row x, so mirrored into the second octant, row x is y - 1 wide
+            table->halfWidth[x] = y - 1;
+            slack += (2 * x) - 1;
+            --x;
+        }
+    }
+}
+
+static const ArcRingSpans* getArcRingSpans(TFT_t* dev, uint8_t outerRadius, uint8_t innerRadius)
+{
+    ArcRingSpans* arcRing = &dev->_arcRing;
+
+    if (!arcRing->valid || arcRing->outerRadius != outerRadius || arcRing->innerRadius != innerRadius) {
+        uint32_t outer = outerRadius;
+        uint32_t inner = innerRadius;
+
+        // Pixel centres within half a pixel of an edge are partly covered
+        buildArcSpanTable(&arcRing->solid, (outer * outer) - outer);
+        buildArcSpanTable(&arcRing->reach, (outer * outer) + outer);
+        buildArcSpanTable(&arcRing->holeEdge, (inner * inner) + inner);
+        buildArcSpanTable(&arcRing->hole, (inner * inner) - inner);
+        arcRing->outerRadius = outerRadius;
+        arcRing->innerRadius = innerRadius;
+        arcRing->valid = true;
+    }
+    return arcRing;
+}
+
+// Half width of row in table, -1 when the row is outside
+static inline int16_t arcSpan(const ArcSpanTable* table, uint16_t row)
+{
+    return (row <= table->rows) ? table->halfWidth[row] : -1;
+}
+
+// Whole degrees, clockwise from 12 o'clock, of the pixel dx, dy from the centre, rounded down. Within each quarter the
+// angle from the axis it starts at is found by binary search over the first octant, for the largest angle whose tangent
+// is at most the smaller offset over the larger, compared as a ratio of sines. No division or trigonometry per pixel.
+static uint16_t pixelAngle(int32_t dx, int32_t dy)
+{
+    uint32_t across = (dx < 0) ? -dx : dx;
+    uint32_t along = (dy < 0) ? -dy : dy;
+
+    // Quarters start at up, right, down and left
+    uint8_t quarter = (dx >= 0) ? ((dy < 0) ? 0 : 1) : ((dy >= 0) ? 2 : 3);
+    uint32_t opposite = (quarter % 2 == 0) ? across : along;
+    uint32_t adjacent = (quarter % 2 == 0) ? along : across;
+    uint32_t minor = (opposite < adjacent) ? opposite : adjacent;
+    uint32_t major = (opposite < adjacent) ? adjacent : opposite;
+    uint16_t low = 0;
+    uint16_t high = 45;
+
+    while (low < high) {
+        uint16_t middle = (low + high + 1) / 2;
+
+        if (arcSines[middle] * major <= arcSines[90 - middle] * minor) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    if (opposite > adjacent) {
+        // Past the diagonal the angle is 90 less the one found, so rounding down takes a degree off unless it was exact
+        low = 90 - low - ((arcSines[low] * major == arcSines[90 - low] * minor) ? 0 : 1);
+    }
+    return (quarter * 90) + low;
+}
+
+static inline bool angleInSector(uint16_t angle, uint16_t startAngle, uint16_t sweep)
+{
+    return ((angle + 360 - startAngle) % 360) < sweep;
+}
+
+// Point at radius and whole degrees angle from the centre, rounded to the nearest pixel
+static void arcPoint(int32_t centerX, int32_t centerY, int32_t radius, int32_t angle, int32_t* x, int32_t* y)
+{
+    angle = ((angle % 360) + 360) % 360;
+
+    int32_t quarter = angle % 90;
+    int32_t sine = arcSines[(angle / 90) % 2 ? 90 - quarter : quarter];
+    int32_t cosine = arcSines[(angle / 90) % 2 ? quarter : 90 - quarter];
+    int32_t half = 1 << (ARC_SINE_SHIFT - 1);
+
+    sine = (angle < 180) ? sine : -sine;
+    cosine = (angle < 90 || angle >= 270) ? cosine : -cosine;
+
+    *x = centerX + (((radius * sine) + half) >> ARC_SINE_SHIFT);
+    *y = centerY - (((radius * cosine) + half) >> ARC_SINE_SHIFT);
+}
+
+// Boxes around a ring sector, split at the quarter turns so within each one the sector's corners are its extremes.
+// Returns how many, at most five.
+static uint8_t arcSectorAreas(uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t startAngle, uint16_t sweep, ScreenArea* areas)
+{
+    uint8_t count = 0;
+
+    for (uint16_t from = startAngle; from < startAngle + sweep;)
+    {
+        uint16_t to = ((from / 90) + 1) * 90;
+        int32_t x1 = INT32_MAX;
+        int32_t y1 = INT32_MAX;
+        int32_t x2 = INT32_MIN;
+        int32_t y2 = INT32_MIN;
+
+        to = (to < startAngle + sweep) ? to : startAngle + sweep;
+
+        // A degree either side covers pixels rounding into the sector, and a pixel either side its blended edges
+        for (uint8_t corner = 0; corner < 4; ++corner)
+        {
+            int32_t x;
+            int32_t y;
+
+            arcPoint(centerX, centerY, (corner & 1) ? innerRadius : outerRadius, (corner & 2) ? to + 1 : from - 1, &x, &y);
+            x1 = (x < x1) ? x : x1;
+            y1 = (y < y1) ? y : y1;
+            x2 = (x > x2) ? x : x2;
+            y2 = (y > y2) ? y : y2;
+        }
+
+        areas[count].x1 = (x1 - 1 > centerX - outerRadius) ? x1 - 1 : centerX - outerRadius;
+        areas[count].y1 = (y1 - 1 > centerY - outerRadius) ? y1 - 1 : centerY - outerRadius;
+        areas[count].x2 = (x2 + 1 < centerX + outerRadius) ? x2 + 1 : centerX + outerRadius;
+        areas[count].y2 = (y2 + 1 < centerY + outerRadius) ? y2 + 1 : centerY + outerRadius;
+        ++count;
+        from = to;
+    }
+    return count;
+}
+
+static inline uint8_t clampArcLevel(int32_t level)
+{
+    return (level < 0) ? 0 : (level > TEXT_BLEND_LEVELS) ? TEXT_BLEND_LEVELS : level;
+}
+
+// The command's area is the box around its whole circle, with the centre pixel in the middle
+static void rasteriseArc(TFT_t* dev, const RenderTarget* target, const DrawCommand* command)
+{
+    ScreenArea area;
+    ScreenArea sectors[5];
+    uint8_t sectorCount;
+    int32_t outer = command->outerRadius;
+    int32_t inner = command->innerRadius;
+    int32_t centerX = command->area.x1 + outer;
+    int32_t centerY = command->area.y1 + outer;
+
+    // Only the box around the sector needs visiting
+    sectorCount = arcSectorAreas(centerX, centerY, outer, inner, command->startAngle, command->sweep, sectors);
+    area = sectors[0];
+    for (uint8_t s = 1; s < sectorCount; ++s)
+    {
+        area.x1 = (sectors[s].x1 < area.x1) ? sectors[s].x1 : area.x1;
+        area.y1 = (sectors[s].y1 < area.y1) ? sectors[s].y1 : area.y1;
+        area.x2 = (sectors[s].x2 > area.x2) ? sectors[s].x2 : area.x2;
+        area.y2 = (sectors[s].y2 > area.y2) ? sectors[s].y2 : area.y2;
+    }
+
+    if (!clipToTarget(target, &area)) {
+        return;
+    }
+
+    const ArcRingSpans* spans = getArcRingSpans(dev, command->outerRadius, command->innerRadius);
+    uint32_t colour = expandColour(reverseBytes(command->colour));
+    uint32_t background = expandColour(reverseBytes(command->arcBackground));
+    bool overBackground = command->arcFlags & ARC_OVER_BACKGROUND;
+
+    for (uint16_t y = area.y1; y <= area.y2; ++y)
+    {
+        int32_t dy = y - centerY;
+        uint16_t row = (dy < 0) ? -dy : dy;
+        int16_t reach = arcSpan(&spans->reach, row);
+        int16_t solid = arcSpan(&spans->solid, row);
+        int16_t holeEdge = (inner > 0) ? arcSpan(&spans->holeEdge, row) : -1;
+        int16_t hole = (inner > 0) ? arcSpan(&spans->hole, row) : -1;
+
+        if (reach < 0) {
+            continue;
+        }
+
+        int32_t x1 = (centerX - reach > area.x1) ? centerX - reach : area.x1;
+        int32_t x2 = (centerX + reach < area.x2) ? centerX + reach : area.x2;
+
+        for (int32_t x = x1; x <= x2; ++x)
+        {
+            int32_t dx = x - centerX;
+            int32_t across = (dx < 0) ? -dx : dx;
+            uint8_t level = TEXT_BLEND_LEVELS;
+
+            if (across <= hole) {
+                // Skip over the hole
+                x = centerX + hole;
+                continue;
+            }
+
+            if (across > solid || across <= holeEdge) {
+                int32_t distance = (dx * dx) + (dy * dy);
+                int32_t half = TEXT_BLEND_LEVELS / 2;
+
+                // Distance past an edge is about the difference of the squares over twice the radius
+                level = clampArcLevel(half + ((half * 2 * ((outer * outer) - distance)) / (2 * outer)));
+                if (inner > 0) {
+                    level = (level * clampArcLevel(half + ((half * 2 * (distance - (inner * inner))) / (2 * inner)))) >> TEXT_BLEND_SHIFT;
+                }
+                if (level == 0) {
+                    continue;
+                }
+            }
+
+            if (command->sweep < 360 && !angleInSector(pixelAngle(dx, dy), command->startAngle, command->sweep)) {
+                continue;
+            }
+
+            uint16_t* destination = targetPixel(target, x, y);
+
+            if (level >= TEXT_BLEND_LEVELS) {
+                *destination = command->colour;
+            } else {
+                uint32_t under = overBackground ? background : expandColour(reverseBytes(*destination));
+                *destination = reverseBytes(compactColour(((colour * level) + (under * (TEXT_BLEND_LEVELS - level))) >> TEXT_BLEND_SHIFT));
+            }
+        }
+    }
+}
+
+
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+
+// Palette
+// --------
+
+static inline uint16_t paletteLookupKey(uint16_t colour)
+{
+    return ((colour >> 4) & 0xF00) | ((colour >> 3) & 0x0F0) | ((colour >> 1) & 0x00F);
+}
+
+static inline uint16_t paletteExactSlot(uint16_t wireColour)
+{
+    return ((uint32_t)wireColour * 2654435761u) >> (32 - 9);
+}
+
+// Exact entries win, anything else gets the entry closest to its 4 bit per channel cell
+static uint8_t nearestPaletteIndex(uint16_t wireColour)
+{
+    uint8_t index = paletteLookup[paletteLookupKey(reverseBytes(wireColour))];
+
+    if (screenPalette[index] == wireColour) {
+        return index;
+    }
+
+    // The table is never more than half full, so a probe ends on an empty slot after a step or two
+    for (uint16_t slot = paletteExactSlot(wireColour); paletteExact[slot] != PALETTE_EXACT_EMPTY; slot = (slot + 1) % PALETTE_EXACT_SLOTS)
+    {
+        if (screenPalette[paletteExact[slot]] == wireColour) {
+            return paletteExact[slot];
+        }
+    }
+    return index;
+}
+
+static void expandIndexedArea(TFT_t* dev, const RenderTarget* target)
+{
+    for (uint16_t h = target->area.y1; h <= target->area.y2; ++h)
+    {
+        const uint8_t* indices = &dev->_buffer[(h * dev->_width) + target->area.x1];
+        uint16_t* row = targetPixel(target, target->area.x1, h);
+
+        for (uint16_t w = 0; w <= target->area.x2 - target->area.x1; ++w)
+        {
+            row[w] = screenPalette[indices[w]];
+        }
+    }
+}
+
+bool setScreenPalette(const uint16_t* palette, uint16_t count)
+{
+    if (count == 0 || count > 256) {
+        ERROR("Invalid palette size %i", count);
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        screenPalette[i] = toWireColour(palette[i]);
+    }
+    screenPaletteSize = count;
+
+    // First entry of every colour, like a scan from the start of the palette would find
+    memset(paletteExact, 0xFF, sizeof(paletteExact));
+
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        uint16_t slot = paletteExactSlot(screenPalette[i]);
+
+        while (paletteExact[slot] != PALETTE_EXACT_EMPTY && screenPalette[paletteExact[slot]] != screenPalette[i]) {
+            slot = (slot + 1) % PALETTE_EXACT_SLOTS;
+        }
+        if (paletteExact[slot] == PALETTE_EXACT_EMPTY) {
+            paletteExact[slot] = i;
+        }
+    }
+
+    // Nearest entry to the centre of every cell, by squared distance in 8 bit per channel RGB
+    for (uint16_t key = 0; key < 4096; ++key)
+    {
+        int16_t r = ((key >> 8) << 4) + 8;
+        int16_t g = (((key >> 4) & 0xF) << 4) + 8;
+        int16_t b = ((key & 0xF) << 4) + 8;
+        uint32_t closest = UINT32_MAX;
+
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            uint16_t colour = toNativeColour(palette[i]);
+            int16_t dr = r - ((colour >> 8) & 0xF8);
+            int16_t dg = g - ((colour >> 3) & 0xFC);
+            int16_t db = b - ((colour << 3) & 0xF8);
+            uint32_t distance = (dr * dr) + (dg * dg) + (db * db);
+
+            if (distance < closest) {
+                closest = distance;
+                paletteLookup[key] = i;
+            }
+        }
+    }
+
+    return true;
+}
+
+// 3 bits red, 3 bits green, 2 bits blue
+bool setDefaultScreenPalette()
+{
+    uint16_t palette[256];
+
+    for (uint16_t i = 0; i < 256; ++i)
+    {
+        uint8_t r = (i >> 5) & 0x07;
+        uint8_t g = (i >> 2) & 0x07;
+        uint8_t b = i & 0x03;
+
+        palette[i] = SCREEN_COLOUR((((r * 31) / 7) << 11) | (((g * 63) / 7) << 5) | ((b * 31) / 3));
+    }
+    return setScreenPalette(palette, 256);
+}
+
+#endif
+
+// Setup
+// ------
+
+bool setupScreenIO(TFT_t* dev, const ScreenConfig* config);
+static void setFrameTiming(TFT_t* dev, uint8_t division, uint8_t clocks);
+#ifdef SCREEN_FRAME_PACING
+static bool setupFramePacing(TFT_t* dev, int clockSpeedHz);
+#endif
+
+// Init table format: command, argument count, arguments. SCREEN_INIT_DELAY in the count means a delay in ms follows the arguments.
+const uint8_t ili9341DefaultInitTable[] = {
+    ILI9341_POWER1, 1, 0x23,                                    // Power Control 1
+    ILI9341_POWER2, 1, 0x10,                                    // Power Control 2
+    ILI9341_VCOM1, 2, 0x3E, 0x28,                               // VCOM Control 1
+    ILI9341_VCOM2, 1, 0x86,                                     // VCOM Control 2
+    ILI9341_MEMORY_ACCESS_CONTROL, 1, 0x08,                     // Bottom right start, RGB color filter panel
+    ILI9341_PIXEL_FORMAT, 1, 0x55,                              // 65K color: 16-bit/pixel
+    ILI9341_DISPLAY_INVERSION_OFF, 0,
+    ILI9341_DISPLAY_FUNCTION_CONTROL, 4, 0x08, 0xA2, 0x27, 0x00, // REV:1 GS:0 SS:0 SM:0
+    ILI9341_SET_GAMMA, 1, 0x01,
+    ILI9341_POSITIVE_GAMMA_CORRECTION, 15,
+        0x0F, 0x31, 0x2B, 0x0C, 0x0E, 0x08, 0x4E, 0xF1, 0x37, 0x07, 0x10, 0x03, 0x0E, 0x09, 0x00,
+    ILI9341_NEGATIVE_GAMMA_CORRECTION, 15,
+        0x00, 0x0E, 0x14, 0x03, 0x11, 0x07, 0x31, 0xC1, 0x48, 0x08, 0x0F, 0x0C, 0x31, 0x36, 0x0F,
+    ILI9341_SLEEP_OUT, 0 | SCREEN_INIT_DELAY, 120,
+    ILI9341_DISPLAY_ON, 0,
+    SCREEN_INIT_END
+};
+
+// The screen wired as in pinmap.h
+static bool defaultScreenConfig(ScreenConfig* config)
+{
+    if (screenBufferTaken) {
+        ERROR("The default screen buffer is already in use, pass a config with a buffer");
+        return false;
+    }
+    screenBufferTaken = true;
+
+    *config = (ScreenConfig) {
+        .width = SCREEN_WIDTH,
+        .height = SCREEN_HEIGHT,
+        .csPin = SCREEN_CS_PIN,
+        .dcPin = SCREEN_DC_PIN,
+        .resetPin = SCREEN_RESET_PIN,
+#ifdef SCREEN_TE_PIN
+        .tePin = SCREEN_TE_PIN,
+#else
+        .tePin = -1,
+#endif
+        .backlightPin = SLEEP_PIN,
+        .clockSpeedHz = SCREEN_SPI_CLOCK_HZ,
+        .bus = &defaultBus,
+#ifndef SCREEN_STRIP_RENDERER
+        .buffer = screenBuffer
+#endif
+    };
+    return true;
+}
+
+// Arguments of the last entry for command in an init table, NULL when the table does not send it
+static const uint8_t* findTableCommand(const uint8_t* table, uint8_t command, uint8_t argumentCount)
+{
+    const uint8_t* found = NULL;
+
+    while (*table != SCREEN_INIT_END) {
+        uint8_t count = table[1] & ~SCREEN_INIT_DELAY;
+
+        if (table[0] == command && count >= argumentCount) {
+            found = &table[2];
+        }
+        table += 2 + count + ((table[1] & SCREEN_INIT_DELAY) ? 1 : 0);
+    }
+    return found;
+}
+
+// Everything after the screen is on the bus: the init table, the frame rate and pacing
+static bool setupPanel(TFT_t* dev, const ScreenConfig* config, const uint8_t* initTable)
+{
+    if (!sendCommandTable(dev, initTable)) {
+        ERROR("Could not send init table to screen!");
+        return false;
+    }
+
+    // A table that sets its own frame rate keeps it, the timing just has to follow
+    const uint8_t* frameRate = findTableCommand(initTable, ILI9341_FRAME_RATE_CONTROL, 2);
+
+    if (frameRate != NULL) {
+        setFrameTiming(dev, frameRate[0] & 0x03, frameRate[1] & 0x1F);
+    } else if (!setFrameRate(dev, SCREEN_FRAME_RATE)) {
+        return false;
+    }
+
+#ifdef SCREEN_FRAME_PACING
+    if (!setupFramePacing(dev, config->clockSpeedHz)) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Undoes setupScreenIO for a screen that did not come up, so its setup can be tried again
+static void releaseScreenIO(TFT_t* dev)
+{
+    ScreenBus* bus = dev->_bus;
+
+    // Nothing may be in flight when the device goes
+    waitForTransmission(dev);
+
+#ifdef SCREEN_FRAME_PACING
+    if (dev->_te >= 0) {
+        gpio_isr_handler_remove(dev->_te);
+    }
+#endif
+
+    for (uint8_t i = 0; i < bus->screenCount; ++i)
+    {
+        if (bus->screens[i] == dev) {
+            memmove(&bus->screens[i], &bus->screens[i + 1], (bus->screenCount - i - 1) * sizeof(TFT_t*));
+            --bus->screenCount;
+            break;
+        }
+    }
+
+    if (spi_bus_remove_device(dev->_SPIHandle) != ESP_OK) {
+        ERROR("Could not remove screen from SPI host %i", bus->host);
+    }
+    dev->_SPIHandle = NULL;
+}
+
+bool setupScreen(TFT_t* dev, const ScreenConfig* config)
+{
+    return setupScreenWithTable(dev, config, ili9341DefaultInitTable);
+}
+
+bool setupScreenWithTable(TFT_t* dev, const ScreenConfig* config, const uint8_t* initTable)
+{
+    ScreenConfig defaultConfig;
+
+    if (config == NULL) {
+        if (!defaultScreenConfig(&defaultConfig)) {
+            return false;
+        }
+        config = &defaultConfig;
+    }
+
+    if (config->width == 0 || config->height == 0 || config->width > SCREEN_WIDTH || config->height > SCREEN_HEIGHT) {
+        ERROR("Screen size %ix%i does not fit the panel", config->width, config->height);
+        return false;
+    }
+#ifdef SCREEN_STRIP_RENDERER
+    if (config->buffer != NULL) {
+        ERROR("Strip renderer screens have no buffer");
+        return false;
+    }
+#else
+    if (config->buffer == NULL) {
+        ERROR("Screen needs a buffer");
+        return false;
+    }
+#endif
+
+    initFonts();
+
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+    if (screenPaletteSize == 0) {
+        setDefaultScreenPalette();
+    }
+#endif
+
+    bool ready = setupScreenIO(dev, config);
+
+    if (ready && !setupPanel(dev, config, initTable)) {
+        releaseScreenIO(dev);
+        ready = false;
+    }
+    if (!ready) {
+        // The screen is off the bus again, so the default buffer is free for another try
+        if (config == &defaultConfig) {
+            screenBufferTaken = false;
+        }
+        return false;
+    }
+
+    LOG_BLUE("DONE WITH SCREEN SETUP!\n");
+    return true;
+}
+
+bool sendCommandTable(TFT_t* dev, const uint8_t* table)
+{
+    // The table may hold address or memory access commands, so the cached window can no longer be trusted
+    invalidateScreenWriteArea(dev);
+
+    // The table usually lives in flash, which DMA cannot read, so longer argument lists are copied to staging first
+    uint16_t stagingOffset = 0;
+    uint8_t transaction = 0;
+
+    while (*table != SCREEN_INIT_END) {
+        uint8_t command = table[0];
+        uint8_t argumentCount = table[1] & ~SCREEN_INIT_DELAY;
+        bool delay = table[1] & SCREEN_INIT_DELAY;
+        const uint8_t* arguments = &table[2];
+
+        // Make room for the command and its arguments, and start over in staging once everything queued has gone out
+        if (!collectTransactions(dev, SCREEN_SPI_QUEUE_SIZE - 2)) {
+            return false;
+        }
+        if (stagingOffset + argumentCount > SCREEN_STAGING_BUFFER_SIZE) {
+            if (!waitForTransmission(dev)) {
+                return false;
+            }
+            stagingOffset = 0;
+        }
+
+        if (!queueCommandToScreen(dev, &dev->_stripTransactions[transaction++ % MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND], command)) {
+            return false;
+        }
+
+        if (argumentCount > 0) {
+            memcpy(&COMMAND_STAGING(dev)[stagingOffset], arguments, argumentCount);
+            if (!queueBytesToScreen(dev, &dev->_stripTransactions[transaction++ % MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND], &COMMAND_STAGING(dev)[stagingOffset], argumentCount, 0)) {
+                return false;
+            }
+            stagingOffset += (argumentCount + 3) & ~3;
+        }
+
+        table = arguments + argumentCount;
+
+        if (delay) {
+            if (!waitForTransmission(dev)) {
+                return false;
+            }
+            stagingOffset = 0;
+            vTaskDelay(milliseconds(*table));
+            ++table;
+        }
+    }
+
+    return waitForTransmission(dev);
+}
+
+bool setupScreenIO(TFT_t* dev, const ScreenConfig* config)
+{
+    ScreenBus* bus = config->bus;
+
+    if (bus->screenCount >= SCREEN_BUS_MAX_SCREENS) {
+        ERROR("No room for another screen on SPI host %i", bus->host);
+        return false;
+    }
+
+    uint64_t outputs = 1ULL << config->dcPin;
+
+    if (config->csPin >= 0) {
+        outputs |= 1ULL << config->csPin;
+    }
+    if (config->resetPin >= 0) {
+        outputs |= 1ULL << config->resetPin;
+    }
+
+    gpio_config_t gpio_conf;                        // Configuration struct    
+    gpio_conf.intr_type = GPIO_INTR_DISABLE;        // Disable interrupt
+    gpio_conf.mode = GPIO_MODE_OUTPUT;              // Set as output mode
+    gpio_conf.pin_bit_mask = outputs;               // Bit mask of the pins that you want to set, e.g.GPIO18/19
+    gpio_conf.pull_down_en = 0;                     // Disable pull-down mode
+    gpio_conf.pull_up_en = 0;                       // Disable pull-up mode
+    gpio_config(&gpio_conf);
+
+    if (config->resetPin >= 0) {
+        gpio_set_level(config->resetPin, 1);
+        vTaskDelay(milliseconds(10));
+    }
+
+    // Screens are set up in place, so start from nothing
+    memset(dev, 0, sizeof(TFT_t));
+#ifdef SCREEN_PERF_COUNTERS
+    resetScreenPerfCounters(dev);
+#endif
+
+    dev->_model = 0x9341;
+    dev->_width = config->width;
+    dev->_height = config->height;
+    dev->_offsetx = 0;
+    dev->_offsety = 0;
+    dev->_font_direction = 0;
+    dev->_font_fill = false;
+    dev->_font_underline = false;
+    dev->_transactionsInFlight = 0;
+    dev->_transmissionDone = true;
+    dev->_cs = config->csPin;
+    dev->_dc = config->dcPin;
+    dev->_reset = config->resetPin;
+    dev->_te = config->tePin;
+    dev->_bl = config->backlightPin;
+    dev->_bus = bus;
+#ifndef SCREEN_STRIP_RENDERER
+    dev->_buffer = config->buffer;
+#endif
+
+    spi_device_interface_config_t devcfg={
+        .clock_speed_hz = config->clockSpeedHz, // Was: SPI_MASTER_FREQ_40M --> (40000000)
+        .spics_io_num = config->csPin,
+        .queue_size = SCREEN_SPI_QUEUE_SIZE, // Was 7
+        .flags = SPI_DEVICE_NO_DUMMY,
+        .pre_cb = screenTransactionStart,
+        .post_cb = screenTransactionDone
+    };
+
+    if (spi_bus_add_device(bus->host, &devcfg, &dev->_SPIHandle) != ESP_OK) {
+        ERROR("Could not add screen to SPI host %i", bus->host);
+        return false;
+    }
+
+    bus->screens[bus->screenCount++] = dev;
+
+    STATUS("Done with Screen IO!");
+
+    return true;
+}
+
+// Frame rate and pacing
+// ----------------------
+
+// Every frame the panel scans its lines plus the front and back porches, each line taking RTNA clocks of its oscillator
+// divided by 2^DIVA. The porches are left at their defaults of two lines each.
+#define PANEL_OSCILLATOR_HZ 615000
+#define PANEL_FRONT_PORCH_LINES 2
+#define PANEL_BLANKING_LINES 4
+#define PANEL_FRAME_LINES (SCREEN_HEIGHT + PANEL_BLANKING_LINES)
+
+bool setFrameRate(TFT_t* dev, uint8_t framesPerSecond)
+{
+    uint32_t target = framesPerSecond * 1000;
+    uint32_t bestError = UINT32_MAX;
+    uint8_t arguments[2] = { 0, 0 };
+
+    if (framesPerSecond == 0) {
+        ERROR("Invalid frame rate 0");
+        return false;
+    }
+
+    for (uint8_t division = 0; division < 4; ++division)
+    {
+        for (uint8_t clocks = 0x10; clocks <= 0x1F; ++clocks)
+        {
+            // mHz, so the lowest rates can still be told apart
+            uint32_t rate = ((uint64_t)PANEL_OSCILLATOR_HZ * 1000) / ((uint32_t)(clocks << division) * PANEL_FRAME_LINES);
+            uint32_t error = (rate > target) ? rate - target : target - rate;
+
+            if (error < bestError) {
+                bestError = error;
+                arguments[0] = division;
+                arguments[1] = clocks;
+            }
+        }
+    }
+
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+    if (!pollCommandToScreen(dev, ILI9341_FRAME_RATE_CONTROL, arguments, 2)) {
+        ERROR("Could not set frame rate on screen");
+        return false;
+    }
+
+    setFrameTiming(dev, arguments[0], arguments[1]);
+    return true;
+}
+
+// Follows the DIVA and RTNA the panel was just sent
+static void setFrameTiming(TFT_t* dev, uint8_t division, uint8_t clocks)
+{
+    dev->_lineTimeNs = ((uint64_t)(clocks << division) * 1000000000ULL) / PANEL_OSCILLATOR_HZ;
+    dev->_framePeriodNs = dev->_lineTimeNs * PANEL_FRAME_LINES;
+
+#ifdef SCREEN_FRAME_PACING
+    if (dev->_te < 0) {
+        // Nothing tells where the scan is, so assume the new timing starts a frame now
+        dev->_lastVsyncUs = esp_timer_get_time() - ((PANEL_FRONT_PORCH_LINES * dev->_lineTimeNs) / 1000);
+    }
+#endif
+}
+
+#ifdef SCREEN_FRAME_PACING
+
+// TE rises as the scan leaves the last line
+static void IRAM_ATTR tearingEffectStart(void* arg)
+{
+    TFT_t* dev = arg;
+    int64_t now = esp_timer_get_time();
+    int64_t intervalNs = (now - dev->_lastVsyncUs) * 1000;
+
+    // The panel's oscillator is only good to a few percent, so follow its real period, skipping gaps where pulses were missed
+    if (dev->_pacingStats.vsyncs > 0 && intervalNs > dev->_framePeriodNs / 2 && intervalNs < ((int64_t)dev->_framePeriodNs * 3) / 2) {
+        dev->_framePeriodNs = ((7 * (int64_t)dev->_framePeriodNs) + intervalNs) / 8;
+        dev->_lineTimeNs = dev->_framePeriodNs / PANEL_FRAME_LINES;
+    }
+    dev->_lastVsyncUs = now;
+    ++dev->_pacingStats.vsyncs;
+}
+
+static bool setupFramePacing(TFT_t* dev, int clockSpeedHz)
+{
+    // 16 bits a pixel at the SPI clock, until sends show how long they really take
+    dev->_pixelWriteTime = (16ULL * 1000000000ULL * 16) / clockSpeedHz;
+    dev->_pacedPixels = 0;
+
+    if (dev->_te < 0) {
+        return true;
+    }
+
+    gpio_config_t gpio_conf = {
+        .pin_bit_mask = 1ULL << dev->_te,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = 0,
+        .pull_down_en = 0,
+        .intr_type = GPIO_INTR_POSEDGE
+    };
+    gpio_config(&gpio_conf);
+
+    // Other drivers may have installed the ISR service already
+    esp_err_t installed = gpio_install_isr_service(0);
+
+    if ((installed != ESP_OK && installed != ESP_ERR_INVALID_STATE) || gpio_isr_handler_add(dev->_te, tearingEffectStart, dev) != ESP_OK) {
+        ERROR("Could not set up the TE interrupt");
+        return false;
+    }
+
+    // TE through vertical blanking only
+    uint8_t mode = 0x00;
+
+    if (!waitForTransmission(dev) || !pollCommandToScreen(dev, ILI9341_TEARING_EFFECT_LINE_ON, &mode, 1)) {
+        ERROR("Could not turn on TE output on screen");
+        return false;
+    }
+
+    // Sends can only be paced once a pulse has shown where the scan is
+    int64_t timeout = esp_timer_get_time() + ((2 * (int64_t)dev->_framePeriodNs) / 1000);
+
+    dev->_lastVsyncUs = 0;
+    while (dev->_lastVsyncUs == 0 && esp_timer_get_time() < timeout) {
+        esp_rom_delay_us(100);
+    }
+    if (dev->_lastVsyncUs == 0) {
+        ERROR("No TE pulses from screen on pin %i", dev->_te);
+    }
+    return true;
+}
+
+// Sleeps through whole ticks while more than one is left, as a delay may end up to a tick early, then spins
+static void waitUntil(int64_t timeUs)
+{
+    int64_t tickUs = portTICK_PERIOD_MS * 1000;
+    int64_t remaining = timeUs - esp_timer_get_time();
+
+    if (remaining > 2 * tickUs) {
+        vTaskDelay((remaining / tickUs) - 1);
+        remaining = timeUs - esp_timer_get_time();
+    }
+    if (remaining > 0) {
+        esp_rom_delay_us(remaining);
+    }
+}
+
+// Display line the scan shows row on, which vertical scrolling moves within the scroll area
+static uint16_t scanLineOfRow(TFT_t* dev, uint16_t row)
+{
+    if (dev->_scrollArea == 0 || row < dev->_topFixedArea || row >= dev->_topFixedArea + dev->_scrollArea) {
+        return row;
+    }
+    return dev->_topFixedArea + ((row + dev->_scrollArea - dev->_scrollStart) % dev->_scrollArea);
+}
+
+// First row after row, up to y2, whose scan line does not follow on from the row before it, or y2 + 1 when there is
+// none. Scrolled content breaks at the edges of the scroll area and where it wraps.
+static uint16_t nextScanBreak(TFT_t* dev, uint16_t row, uint16_t y2)
+{
+    uint16_t next = y2 + 1;
+
+    if (dev->_scrollArea == 0 || dev->_scrollStart == dev->_topFixedArea) {
+        return next;
+    }
+
+    uint16_t breaks[3] = { dev->_topFixedArea, dev->_scrollStart, dev->_topFixedArea + dev->_scrollArea };
+
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        if (breaks[i] > row && breaks[i] < next) {
+            next = breaks[i];
+        }
+    }
+    return next;
+}
+
+// Rows of y1 to y2 the gap from scan to write has to be checked at: the ends of the area and both sides of every scan
+// break. Between two of them the gap is linear.
+static uint8_t pacedWriteBreaks(TFT_t* dev, uint16_t y1, uint16_t y2, uint16_t* rows)
+{
+    uint8_t count = 0;
+
+    rows[count++] = y1;
+    for (uint16_t row = nextScanBreak(dev, y1, y2); row <= y2; row = nextScanBreak(dev, row, y2))
+    {
+        rows[count++] = row - 1;
+        rows[count++] = row;
+    }
+    rows[count++] = y2;
+    return count;
+}
+
+// Waits until rows y1 to y2, width pixels wide, can be written without the scan crossing the write pointer. The scan
+// reaches a row at vsync + blanking + its scan line, the write reaches row y at start + (y - y1) row write times.
+// Every row has to be written between the same two scans of its line, so the gap between the two has to stay within
+// one frame over the whole area, margin included at both ends. Scrolling makes the gap jump where the scan lines stop
+// following the rows, so it is taken at every such break.
+static bool beginPacedWrite(TFT_t* dev, uint16_t y1, uint16_t y2, uint16_t width)
+{
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+    int64_t period = dev->_framePeriodNs;
+    int64_t lineTime = dev->_lineTimeNs;
+    int64_t rowTime = ((int64_t)width * dev->_pixelWriteTime) / 16;
+    int64_t margin = SCREEN_PACING_MARGIN_LINES * lineTime;
+    int64_t now = esp_timer_get_time() * 1000;
+
+    // Gap from scan to write at every break, relative to a write starting at the last vsync
+    uint16_t breaks[8];
+    int64_t offsets[8];
+    uint8_t breakCount = pacedWriteBreaks(dev, y1, y2, breaks);
+    int64_t earliest = INT64_MAX;
+    int64_t latest = INT64_MIN;
+
+    for (uint8_t i = 0; i < breakCount; ++i)
+    {
+        offsets[i] = ((int64_t)(breaks[i] - y1) * rowTime) - ((PANEL_BLANKING_LINES + scanLineOfRow(dev, breaks[i])) * lineTime);
+        earliest = (offsets[i] < earliest) ? offsets[i] : earliest;
+        latest = (offsets[i] > latest) ? offsets[i] : latest;
+    }
+
+    int64_t spread = latest - earliest;
+
+    ++dev->_pacingStats.sends;
+    dev->_pacedPixels = (uint32_t)width * (y2 - y1 + 1);
+    dev->_pacedDeadlineUs = INT64_MAX;
+
+    if (spread + (2 * margin) > period) {
+        // Slower than the scan by more than a frame over the area, so part of it tears wherever it starts
+        ++dev->_pacingStats.deadlineMisses;
+        dev->_pacedStartUs = now / 1000;
+        return true;
+    }
+
+    // Smallest gap from scan to write over the area if the write started now, within the frame
+    int64_t gap = now - (dev->_lastVsyncUs * 1000) + earliest;
+    int64_t phase = ((gap % period) + period) % period;
+    int64_t wait = 0;
+
+    if (phase < margin) {
+        wait = margin - phase;
+    } else if (phase > period - margin - spread) {
+        wait = period - phase + margin;
+    }
+
+    int64_t start = now + wait;
+    int64_t startPhase = (phase + wait) % period;
+    int64_t latestStart = start + (period - spread - startPhase);
+
+    if (wait > 0) {
+        ++dev->_pacingStats.waits;
+        dev->_pacingStats.totalWaitUs += wait / 1000;
+        if (wait / 1000 > dev->_pacingStats.maxWaitUs) {
+            dev->_pacingStats.maxWaitUs = wait / 1000;
+        }
+        waitUntil((start + 999) / 1000);
+    }
+
+    dev->_pacedStartUs = esp_timer_get_time();
+
+    if (dev->_pacedStartUs * 1000 > latestStart) {
+        // Woken too late, the first rows are already behind the next scan
+        ++dev->_pacingStats.deadlineMisses;
+    } else {
+        // Every row has to be written before the scan comes back around to it. A write running late falls behind in
+        // proportion to how far into the area it is, which bounds how late the last row can be.
+        int64_t slack = period - startPhase;
+
+        for (uint8_t i = 0; i < breakCount; ++i)
+        {
+            if (breaks[i] > y1) {
+                int64_t rowSlack = ((period - startPhase - (offsets[i] - earliest)) * (y2 - y1)) / (breaks[i] - y1);
+                slack = (rowSlack < slack) ? rowSlack : slack;
+            }
+        }
+        dev->_pacedDeadlineUs = (start + ((int64_t)(y2 - y1) * rowTime) + slack) / 1000;
+    }
+    return true;
+}
+
+// Checks the send beginPacedWrite planned against its deadline, and learns how long a pixel really takes
+static void finishPacedWrite(TFT_t* dev)
+{
+    if (dev->_pacedPixels == 0) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+
+    if (now > dev->_pacedDeadlineUs) {
+        ++dev->_pacingStats.deadlineMisses;
+    }
+
+    // Anything smaller than a row is mostly setup
+    if (dev->_pacedPixels >= dev->_width) {
+        uint32_t measured = ((now - dev->_pacedStartUs) * 1000 * 16) / dev->_pacedPixels;
+        dev->_pixelWriteTime = ((3 * dev->_pixelWriteTime) + measured) / 4;
+    }
+    dev->_pacedPixels = 0;
+}
+
+void getFramePacingStats(TFT_t* dev, FramePacingStats* stats)
+{
+    *stats = dev->_pacingStats;
+    stats->framePeriodUs = dev->_framePeriodNs / 1000;
+    stats->pixelWriteTimeNs = dev->_pixelWriteTime / 16;
+}
+
+void resetFramePacingStats(TFT_t* dev)
+{
+    memset(&dev->_pacingStats, 0, sizeof(FramePacingStats));
+}
+
+#endif
+
+// Buffer Transmission
+// --------------------
+
+bool sendEntireBuffer(TFT_t* dev)
+{
+    bool outermost = perfBeginCall(dev, SCREEN_PERF_SEND_ENTIRE_BUFFER);
+    bool sent;
+
+#ifdef SCREEN_FRAME_PACING
+    if (nextScanBreak(dev, 0, dev->_height - 1) < dev->_height) {
+        // Scrolled, so it goes out in runs the scan shows in order, see transmitBufferArea
+        dev->_dirtyAreaCount = 0;
+        sent = transmitBufferArea(dev, 0, 0, dev->_width - 1, dev->_height - 1);
+    } else {
+        sent = sendEntireBufferAsync(dev, NULL, NULL) && waitForTransmission(dev);
+        if (sent) {
+            finishPacedWrite(dev);
+        }
+    }
+#else
+    sent = sendEntireBufferAsync(dev, NULL, NULL) && waitForTransmission(dev);
+#endif
+
+    perfEndCall(dev, outermost, true);
+    return sent;
+}
+
+static bool queueEntireBuffer(TFT_t* dev, void (*onDone)(void* arg), void* arg)
+{
+    // Everything goes out, so nothing is left dirty
+    dev->_dirtyAreaCount = 0;
+
+#ifdef SCREEN_FRAME_PACING
+    if (!beginPacedWrite(dev, 0, dev->_height - 1, dev->_width)) {
+        return false;
+    }
+#endif
+
+    if (!setScreenWriteArea(dev, 0, 0, dev->_width-1, dev->_height-1)) {
+        return false;
+    }
+
+    dev->_transmissionDone = false;
+    dev->_onTransmissionDone = onDone;
+    dev->_onTransmissionDoneArg = arg;
+
+#if defined(SCREEN_STRIP_RENDERER) || defined(SCREEN_INDEXED_FRAMEBUFFER)
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+    resolveDisplayList(dev);
+#endif
+
+    // Strips have to be rendered as they go, so this only returns with the last ones on the wire
+    return sendAreaInStrips(dev, 0, 0, dev->_width - 1, dev->_height - 1, TRANSACTION_SIGNAL_DONE);
+#else
+    resolveDisplayList(dev);
+
+    // Queue every strip up front so the bus never waits on the CPU between strips. A screen smaller than the panel
+    // ends on a shorter one.
+    uint32_t bufferBytes = (uint32_t)dev->_width * dev->_height * 2;
+
+    for (uint8_t i = 0; i * SCREEN_MAX_TRANSMISSION_BUFFER < bufferBytes; ++i)
+    {
+        uint32_t offset = i * SCREEN_MAX_TRANSMISSION_BUFFER;
+        uint32_t length = (bufferBytes - offset < SCREEN_MAX_TRANSMISSION_BUFFER) ? bufferBytes - offset : SCREEN_MAX_TRANSMISSION_BUFFER;
+        uint32_t flags = (offset + length == bufferBytes) ? TRANSACTION_SIGNAL_DONE : 0;
+
+        if (!queueBytesToScreen(dev, &dev->_stripTransactions[i], (uint8_t*) dev->_buffer + offset, length, flags)) {
+            ERROR("Could not send colour buffer to screen");
+            return false;
+        }
+    }
+
+    return true;
+#endif
+}
+
+bool sendEntireBufferAsync(TFT_t* dev, void (*onDone)(void* arg), void* arg)
+{
+    bool outermost = perfBeginCall(dev, SCREEN_PERF_SEND_ENTIRE_BUFFER);
+    bool queued = queueEntireBuffer(dev, onDone, arg);
+
+    perfEndCall(dev, outermost, false);
+    return queued;
+}
+
+static bool transmitBufferArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    // Callers often pass the first pixel past the area, which would otherwise wrap around the screen
+    if (x2 >= dev->_width) {
+        x2 = dev->_width - 1;
+    }
+    if (y2 >= dev->_height) {
+        y2 = dev->_height - 1;
+    }
+    if (x1 > x2 || y1 > y2) {
+        ERROR("Invalid buffer area %i, %i, %i, %i", x1, y1, x2, y2);
+        return false;
+    }
+
+    // Dirty areas fully covered by this transmission do not need to be sent again
+    forgetDirtyAreasInside(dev, x1, y1, x2, y2);
+
+#ifdef SCREEN_FRAME_PACING
+    // Scrolled content is scanned out of row order, so no single write across a scan break can stay clear of the
+    // scan. Each run of rows the scan shows in order goes out as a write of its own.
+    for (uint16_t runY1 = y1; runY1 <= y2;)
+    {
+        uint16_t runY2 = nextScanBreak(dev, runY1, y2) - 1;
+
+        if (!transmitBufferRows(dev, x1, runY1, x2, runY2)) {
+            return false;
+        }
+        runY1 = runY2 + 1;
+    }
+    return true;
+#else
+    return transmitBufferRows(dev, x1, y1, x2, y2);
+#endif
+}
+
+// Sends an area already checked against the screen, as one write
+static bool transmitBufferRows(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+#ifdef SCREEN_FRAME_PACING
+    if (!beginPacedWrite(dev, y1, y2, x2 - x1 + 1)) {
+        return false;
+    }
+#endif
+
+    if (!setScreenWriteArea(dev, x1, y1, x2, y2)) {
+        return false;
+    }
+
+#if defined(SCREEN_STRIP_RENDERER) || defined(SCREEN_INDEXED_FRAMEBUFFER)
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+    resolveDisplayList(dev);
+#endif
+
+    if (!sendAreaInStrips(dev, x1, y1, x2, y2, 0)) {
+        waitForTransmission(dev);
+        return false;
+    }
+#else
+    resolveDisplayList(dev);
+
+    uint32_t rowBytes = (x2 - x1 + 1) * 2;
+    uint16_t rows = y2 - y1 + 1;
+
+    if ((x1 == 0 && x2 == dev->_width - 1) || rows == 1) {
+        // Contiguous in the buffer, so send it from where it is
+        uint32_t areaBytes = rowBytes * rows;
+        uint8_t* area = (uint8_t*)&dev->_buffer[(y1 * dev->_width) + x1];
+        uint8_t i = 0;
+
+        for (uint32_t sent = 0; sent < areaBytes; sent += SCREEN_MAX_TRANSMISSION_BUFFER)
+        {
+            uint32_t length = (areaBytes - sent) < SCREEN_MAX_TRANSMISSION_BUFFER ? (areaBytes - sent) : SCREEN_MAX_TRANSMISSION_BUFFER;
+
+            if (!queueBytesToScreen(dev, &dev->_stripTransactions[i++], area + sent, length, 0)) {
+                waitForTransmission(dev);
+                return false;
+            }
+        }
+    } else {
+        // Pack as many rows as fit in a staging buffer, filling one while the other is on the wire
+        uint16_t rowsPerChunk = SCREEN_STAGING_BUFFER_SIZE / rowBytes;
+        uint8_t chunk = 0;
+
+        for (uint16_t h = 0; h < rows; h += rowsPerChunk)
+        {
+            uint16_t chunkRows = (rows - h) < rowsPerChunk ? (rows - h) : rowsPerChunk;
+            uint8_t buffer = chunk % SCREEN_STAGING_BUFFER_COUNT;
+
+            // Transactions complete in order, so once the count is below the pool size this buffer is free again
+#ifdef SCREEN_PERF_COUNTERS
+            if (dev->_transactionsInFlight >= SCREEN_STAGING_BUFFER_COUNT) {
+                ++dev->_perf.stagingStalls;
+            }
+#endif
+            if (!collectTransactions(dev, SCREEN_STAGING_BUFFER_COUNT - 1)) {
+                return false;
+            }
+
+            uint32_t packStart = perfNow();
+
+            for (uint16_t r = 0; r < chunkRows; ++r)
+            {
+                memcpy(dev->_stagingBuffers[buffer] + (rowBytes * r), &dev->_buffer[((y1 + h + r) * dev->_width) + x1], rowBytes);
+            }
+            perfAddRasterise(dev, packStart);
+
+            if (!queueBytesToScreen(dev, &dev->_stagingTransactions[buffer], dev->_stagingBuffers[buffer], rowBytes * chunkRows, 0)) {
+                waitForTransmission(dev);
+                return false;
+            }
+            ++chunk;
+        }
+    }
+#endif
+
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+#ifdef SCREEN_FRAME_PACING
+    finishPacedWrite(dev);
+#endif
+    return true;
+}
+
+bool sendBufferArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    bool outermost = perfBeginCall(dev, SCREEN_PERF_SEND_BUFFER_AREA);
+    bool sent = transmitBufferArea(dev, x1, y1, x2, y2);
+
+    perfEndCall(dev, outermost, false);
+    return sent;
+}
+
+// Dirty area tracking
+// --------------------
+
+// Cost of sending an area in its own address window, in pixel equivalents
+static uint32_t dirtyAreaCost(const ScreenArea* area)
+{
+    return SCREEN_WINDOW_OVERHEAD_PIXELS + ((uint32_t)(area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1));
+}
+
+static ScreenArea dirtyAreaUnion(const ScreenArea* a, const ScreenArea* b)
+{
+    ScreenArea area = {
+        .x1 = a->x1 < b->x1 ? a->x1 : b->x1,
+        .y1 = a->y1 < b->y1 ? a->y1 : b->y1,
+        .x2 = a->x2 > b->x2 ? a->x2 : b->x2,
+        .y2 = a->y2 > b->y2 ? a->y2 : b->y2
+    };
+    return area;
+}
+
+// Absorb every tracked area where one window is cheaper than two, starting over as the grown area may now reach others
+static void mergeDirtyAreas(TFT_t* dev, ScreenArea* area)
+{
+    uint8_t i = 0;
+
+    while (i < dev->_dirtyAreaCount) {
+        ScreenArea merged = dirtyAreaUnion(area, &dev->_dirtyAreas[i]);
+
+        if (dirtyAreaCost(&merged) <= dirtyAreaCost(area) + dirtyAreaCost(&dev->_dirtyAreas[i])) {
+            *area = merged;
+            dev->_dirtyAreas[i] = dev->_dirtyAreas[--dev->_dirtyAreaCount];
+            i = 0;
+        } else {
+            ++i;
+        }
+    }
+}
+
+static void forgetDirtyAreasInside(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    for (uint8_t i = 0; i < dev->_dirtyAreaCount; ++i)
+    {
+        if (dev->_dirtyAreas[i].x1 >= x1 && dev->_dirtyAreas[i].x2 <= x2 && dev->_dirtyAreas[i].y1 >= y1 && dev->_dirtyAreas[i].y2 <= y2) {
+            dev->_dirtyAreas[i] = dev->_dirtyAreas[--dev->_dirtyAreaCount];
+            --i;
+        }
+    }
+}
+
+void markBufferAreaDirty(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    if (x1 >= dev->_width || y1 >= dev->_height || x1 > x2 || y1 > y2) {
+        return;
+    }
+
+    ScreenArea area = {
+        .x1 = x1,
+        .y1 = y1,
+        .x2 = x2 < dev->_width ? x2 : dev->_width - 1,
+        .y2 = y2 < dev->_height ? y2 : dev->_height - 1
+    };
+
+    mergeDirtyAreas(dev, &area);
+
+    // Out of slots, so fold the new area into whichever existing area grows the least, then retry merging
+    while (dev->_dirtyAreaCount == SCREEN_MAX_DIRTY_AREAS) {
+        uint8_t cheapest = 0;
+        uint32_t cheapestCost = UINT32_MAX;
+
+        for (uint8_t i = 0; i < dev->_dirtyAreaCount; ++i)
+        {
+            ScreenArea merged = dirtyAreaUnion(&area, &dev->_dirtyAreas[i]);
+            uint32_t cost = dirtyAreaCost(&merged) - dirtyAreaCost(&dev->_dirtyAreas[i]);
+
+            if (cost < cheapestCost) {
+                cheapest = i;
+                cheapestCost = cost;
+            }
+        }
+
+        area = dirtyAreaUnion(&area, &dev->_dirtyAreas[cheapest]);
+        dev->_dirtyAreas[cheapest] = dev->_dirtyAreas[--dev->_dirtyAreaCount];
+        mergeDirtyAreas(dev, &area);
+    }
+
+    dev->_dirtyAreas[dev->_dirtyAreaCount++] = area;
+}
+
+bool flushDirty(TFT_t* dev)
+{
+    ScreenArea areas[SCREEN_MAX_DIRTY_AREAS];
+    uint8_t areaCount = dev->_dirtyAreaCount;
+
+    if (areaCount == 0) {
+        return true;
+    }
+
+    memcpy(areas, dev->_dirtyAreas, areaCount * sizeof(ScreenArea));
+    dev->_dirtyAreaCount = 0;
+
+    bool outermost = perfBeginCall(dev, SCREEN_PERF_FLUSH_DIRTY);
+    bool success = true;
+
+    if (areaCount == 1 && areas[0].x1 == 0 && areas[0].y1 == 0 && areas[0].x2 == dev->_width - 1 && areas[0].y2 == dev->_height - 1) {
+        success = sendEntireBuffer(dev);
+    } else {
+        for (uint8_t i = 0; i < areaCount; ++i)
+        {
+            if (!sendBufferArea(dev, areas[i].x1, areas[i].y1, areas[i].x2, areas[i].y2)) {
+                ERROR("Could not send dirty area %i, %i, %i, %i", areas[i].x1, areas[i].y1, areas[i].x2, areas[i].y2);
+                success = false;
+            }
+        }
+    }
+
+    perfEndCall(dev, outermost, true);
+    return success;
+}
+
+// Scrolling
+// ----------
+
+// The scroll area of the screen buffer is kept as a ring, exactly like GRAM, so scrolling moves no pixels in either
+bool setScrollArea(TFT_t* dev, uint16_t topFixedArea, uint16_t bottomFixedArea)
+{
+    if (topFixedArea + bottomFixedArea >= dev->_height) {
+        ERROR("Fixed areas %i and %i leave nothing to scroll", topFixedArea, bottomFixedArea);
+        return false;
+    }
+
+    uint16_t scrollArea = dev->_height - topFixedArea - bottomFixedArea;
+    uint16_t panelBottomFixedArea = bottomFixedArea + (SCREEN_HEIGHT - dev->_height);   // Panel rows below the screen stay put too
+    uint8_t definition[6] = {
+        (topFixedArea >> 8) & 0xFF, topFixedArea & 0xFF,
+        (scrollArea >> 8) & 0xFF, scrollArea & 0xFF,
+        (panelBottomFixedArea >> 8) & 0xFF, panelBottomFixedArea & 0xFF
+    };
+    uint8_t start[2] = { (topFixedArea >> 8) & 0xFF, topFixedArea & 0xFF };
+
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+    if (!pollCommandToScreen(dev, ILI9341_VERTICAL_SCROLLING_DEFINITION, definition, 6) || !pollCommandToScreen(dev, ILI9341_VERTICAL_SCROLLING_START_ADDRESS, start, 2)) {
+        ERROR("Could not define scroll area on screen");
+        return false;
+    }
+
+    dev->_topFixedArea = topFixedArea;
+    dev->_scrollArea = scrollArea;
+    dev->_scrollStart = topFixedArea;
+    return true;
+}
+
+bool scrollScreen(TFT_t* dev, int16_t lines)
+{
+    if (dev->_scrollArea == 0) {
+        ERROR("No scroll area set");
+        return false;
+    }
+
+    int32_t offset = ((int32_t)(dev->_scrollStart - dev->_topFixedArea) + lines) % dev->_scrollArea;
+    uint16_t scrollStart = dev->_topFixedArea + (offset < 0 ? offset + dev->_scrollArea : offset);
+    uint8_t start[2] = { (scrollStart >> 8) & 0xFF, scrollStart & 0xFF };
+
+    if (!waitForTransmission(dev)) {
+        return false;
+    }
+
+    if (!pollCommandToScreen(dev, ILI9341_VERTICAL_SCROLLING_START_ADDRESS, start, 2)) {
+        ERROR("Could not set scroll start on screen");
+        return false;
+    }
+
+    dev->_scrollStart = scrollStart;
+    return true;
+}
+
+uint16_t getScrolledRow(TFT_t* dev, uint16_t screenRow)
+{
+    if (dev->_scrollArea == 0 || screenRow < dev->_topFixedArea || screenRow >= dev->_topFixedArea + dev->_scrollArea) {
+        return screenRow;
+    }
+    return dev->_topFixedArea + (((dev->_scrollStart - dev->_topFixedArea) + (screenRow - dev->_topFixedArea)) % dev->_scrollArea);
+}
+
+// Immediate mode
+// ---------------
+
+// Solid fills go to the panel straight from a buffer of the colour, without a pixel passing through the screen buffer.
+// Every transaction of a fill reads the same buffer, which is only refilled once the fill before it is off the wire.
+
+static bool streamScreenFill(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour, bool updateBuffer)
+{
+    if (x2 > dev->_width || y2 > dev->_height) {
+        ERROR("Area outside screen bounds");
+        return false;
+    } else if (x1 > x2 || y1 > y2) {
+        ERROR("Invalid screen area");
+        return false;
+    } else if (x1 == x2 || y1 == y2) {
+        return true;
+    }
+
+    uint16_t wireColour = toWireColour(colour);
+
+    if (updateBuffer) {
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+        // The buffer only holds palette colours, so show what sending it would
+        wireColour = screenPalette[nearestPaletteIndex(wireColour)];
+#endif
+        // x2 and y2 are exclusive here
+        if (!drawFill(dev, x1, y1, x2 - 1, y2 - 1, wireColour)) {
+            return false;
+        }
+
+        // The panel already shows the fill over anything drawn there before
+        forgetDirtyAreasInside(dev, x1, y1, x2 - 1, y2 - 1);
+    }
+
+#ifdef SCREEN_FRAME_PACING
+    if (!beginPacedWrite(dev, y1, y2 - 1, x2 - x1)) {
+        return false;
+    }
+#endif
+
+    if (!setScreenWriteArea(dev, x1, y1, x2 - 1, y2 - 1)) {
+        return false;
+    }
+
+    if (!dev->_patternValid || dev->_patternColour != wireColour) {
+        uint32_t fillStart = perfNow();
+
+        spanFill(dev->_patternBuffer, wireColour, SCREEN_PATTERN_BUFFER_SIZE / 2);
+        dev->_patternColour = wireColour;
+        dev->_patternValid = true;
+        perfAddRasterise(dev, fillStart);
+    }
+
+    dev->_transmissionDone = false;
+    dev->_onTransmissionDone = NULL;
+
+    uint32_t areaBytes = (uint32_t)(x2 - x1) * (y2 - y1) * 2;
+    uint8_t transaction = 0;
+
+    for (uint32_t sent = 0; sent < areaBytes; sent += SCREEN_PATTERN_BUFFER_SIZE)
+    {
+        uint32_t length = (areaBytes - sent) < SCREEN_PATTERN_BUFFER_SIZE ? (areaBytes - sent) : SCREEN_PATTERN_BUFFER_SIZE;
+        uint32_t flags = (sent + length == areaBytes) ? TRANSACTION_SIGNAL_DONE : 0;
+
+        // Transactions complete in order, so with a free queue slot the oldest transaction struct is free as well
+        if (!collectTransactions(dev, SCREEN_SPI_QUEUE_SIZE - 1)) {
+            return false;
+        }
+        if (!queueBytesToScreen(dev, &dev->_stripTransactions[transaction++ % MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND], (uint8_t*)dev->_patternBuffer, length, flags)) {
+            waitForTransmission(dev);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool fillScreenAreaWithColour(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour, bool updateBuffer)
+{
+    bool outermost = perfBeginCall(dev, SCREEN_PERF_FILL_SCREEN_AREA);
+    bool filled = streamScreenFill(dev, x1, y1, x2, y2, colour, updateBuffer);
+
+    perfEndCall(dev, outermost, false);
+    return filled;
+}
+
+bool fillEntireScreenWithColour(TFT_t* dev, uint16_t colour, bool updateBuffer)
+{
+    if (updateBuffer) {
+        ++dev->_bufferClears;
+    }
+    return fillScreenAreaWithColour(dev, 0, 0, dev->_width, dev->_height, colour, updateBuffer);
+}
+
+// Screen display
+// ---------------
+
+bool fillEntireBufferWithColour(TFT_t* dev, uint16_t colour)
+{
+#ifdef SCREEN_STRIP_RENDERER
+    if (!drawFill(dev, 0, 0, dev->_width - 1, dev->_height - 1, toWireColour(colour))) {
+        return false;
+    }
+#elif defined(SCREEN_INDEXED_FRAMEBUFFER)
+    discardDisplayList(dev);
+    memset(dev->_buffer, nearestPaletteIndex(toWireColour(colour)), (uint32_t)dev->_width * dev->_height);
+#else
+    discardDisplayList(dev);
+
+    spanFill(dev->_buffer, toWireColour(colour), (uint32_t)dev->_width * dev->_height);
+#endif
+
+    ++dev->_bufferClears;
+    markBufferAreaDirty(dev, 0, 0, dev->_width - 1, dev->_height - 1);
+    return true;    
+}
+
+bool fillEntireBufferWithImage(TFT_t* dev, struct Image* image) 
+{
+    if (image->width != dev->_width || image->height != dev->_height) {
+        ERROR("Image does not fit screen!");
+        return false;
+    }
+
+    if (!drawImage(dev, 0, 0, image)) {
+        return false;
+    }
+
+    ++dev->_bufferClears;
+    markBufferAreaDirty(dev, 0, 0, dev->_width - 1, dev->_height - 1);
+    return true;
+}
+
+bool fillEntireBufferWithCompressedImage(TFT_t* dev, const CompressedImage* image)
+{
+    if (image->width != dev->_width || image->height != dev->_height) {
+        ERROR("Image does not fit screen!");
+        return false;
+    }
+
+    if (!drawCompressedImage(dev, 0, 0, image)) {
+        return false;
+    }
+
+    ++dev->_bufferClears;
+    markBufferAreaDirty(dev, 0, 0, dev->_width - 1, dev->_height - 1);
+    return true;
+}
+
+bool fillBufferAreaWithColour(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour)
+{
+     if (x2 > dev->_width || y2 > dev->_height) {
+        ERROR("Area outside screen bounds");
+        return false;
+    } else if (x1 > x2 || y1 > y2) {
+        ERROR("Invalid buffer area");
+        return false;
+    } else if (x1 == x2 || y1 == y2) {
+        return true;
+    }
+
+    // x2 and y2 are exclusive here
+    if (!drawFill(dev, x1, y1, x2 - 1, y2 - 1, toWireColour(colour))) {
+        return false;
+    }
+
+    markBufferAreaDirty(dev, x1, y1, x2 - 1, y2 - 1);
+    return true;
+}
+
+bool fillBufferAreaWithImage(TFT_t* dev, uint16_t x1, uint16_t y1, struct Image* image)
+{
+    if (x1 + image->width > dev->_width || y1 + image->height > dev->_height) {
+        ERROR("Image outside screen bounds");
+        return false;
+    } else if (image->width == 0 || image->height == 0) {
+        return true;
+    }
+
+    if (!drawImage(dev, x1, y1, image)) {
+        return false;
+    }
+
+    markBufferAreaDirty(dev, x1, y1, x1 + image->width - 1, y1 + image->height - 1);
+    return true;
+}
+
+bool fillBufferAreaWithCompressedImage(TFT_t* dev, uint16_t x1, uint16_t y1, const CompressedImage* image)
+{
+    if (x1 + image->width > dev->_width || y1 + image->height > dev->_height) {
+        ERROR("Image outside screen bounds");
+        return false;
+    } else if (image->width == 0 || image->height == 0) {
+        return true;
+    }
+
+    if (!drawCompressedImage(dev, x1, y1, image)) {
+        return false;
+    }
+
+    markBufferAreaDirty(dev, x1, y1, x1 + image->width - 1, y1 + image->height - 1);
+    return true;
+}
+
+bool fillBufferAreaWithIndexedImage(TFT_t* dev, uint16_t x1, uint16_t y1, const IndexedImage* image)
+{
+    if (x1 + image->width > dev->_width || y1 + image->height > dev->_height) {
+        ERROR("Image outside screen bounds");
+        return false;
+    } else if (image->bitsPerPixel != 1 && image->bitsPerPixel != 2 && image->bitsPerPixel != 4 && image->bitsPerPixel != 8) {
+        ERROR("Unsupported %i bits per pixel in indexed image", image->bitsPerPixel);
+        return false;
+    } else if (image->width == 0 || image->height == 0) {
+        return true;
+    }
+
+    if (!drawIndexedImage(dev, x1, y1, image)) {
+        return false;
+    }
+
+    markBufferAreaDirty(dev, x1, y1, x1 + image->width - 1, y1 + image->height - 1);
+    return true;
+}
+
+bool frameArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t frameThickness, uint16_t frameColour, uint16_t areaColour)
+{
+    if (!fillBufferAreaWithColour(dev, x1, y1, x2, y2, areaColour)) {
+        return false;
+    }
+
+    if (frameThickness == 0 || x2 - x1 < frameThickness * 2 || y2 - y1 < frameThickness * 2) {
+        return true;
+    }
+
+    uint16_t wireFrameColour = toWireColour(frameColour);
+
+    // Top and bottom
+    // ---------------
+
+    bool success = drawFill(dev, x1, y1, x2 - 1, y1 + frameThickness - 1, wireFrameColour);
+    success &= drawFill(dev, x1, y2 - frameThickness, x2 - 1, y2 - 1, wireFrameColour);
+
+    // Left and Right
+    // ---------------
+
+    if (y2 - y1 > frameThickness * 2) {
+        success &= drawFill(dev, x1, y1 + frameThickness, x1 + frameThickness - 1, y2 - frameThickness - 1, wireFrameColour);
+        success &= drawFill(dev, x2 - frameThickness, y1 + frameThickness, x2 - 1, y2 - frameThickness - 1, wireFrameColour);
+    }
+
+    return success;
+}
+
+bool fillBufferArc(TFT_t* dev, uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t startAngle, uint16_t endAngle, uint16_t colour)
+{
+    if (centerX < outerRadius || centerY < outerRadius || centerX + outerRadius >= dev->_width || centerY + outerRadius >= dev->_height) {
+        ERROR("Arc outside screen bounds");
+        return false;
+    } else if (innerRadius >= outerRadius || endAngle < startAngle || endAngle - startAngle > 360) {
+        ERROR("Invalid arc");
+        return false;
+    } else if (endAngle == startAngle) {
+        return true;
+    }
+
+    ScreenArea areas[5];
+    uint8_t areaCount = arcSectorAreas(centerX, centerY, outerRadius, innerRadius, startAngle % 360, endAngle - startAngle, areas);
+
+    if (!drawArc(dev, centerX, centerY, outerRadius, innerRadius, startAngle, endAngle - startAngle, toWireColour(colour), 0, 0)) {
+        return false;
+    }
+
+    for (uint8_t a = 0; a < areaCount; ++a)
+    {
+        markBufferAreaDirty(dev, areas[a].x1, areas[a].y1, areas[a].x2, areas[a].y2);
+    }
+    return true;
+}
+
+// Glyph cache
+// ------------
+
+// Get mysterious offset - no idea why it is needed
+#define FONT_MYSTERIOUS_OFFSET 18
+
+#define GLYPH_SPAN_PARTIAL 0x01
+
+// One run of equally treated pixels in a glyph row. Opaque runs hold wire order pixels, partial runs hold coverage levels.
+typedef struct GlyphSpan {
+    uint8_t row;
+    uint8_t x;
+    uint8_t length;
+    uint8_t flags;
+} GlyphSpan;
+
+static inline uint8_t shadeToLevel(uint8_t shade)
+{
+    return (shade + (1 << (7 - TEXT_BLEND_SHIFT))) >> (8 - TEXT_BLEND_SHIFT);
+}
+
+// Splits the glyph into spans and pixel data inside slot. Returns false if it does not fit.
+static bool rasteriseGlyphToSlot(struct FontxFile* fx, const CharInfo* glyph, uint16_t wireColour, GlyphCacheEntry* entry, uint32_t* slot)
+{
+    uint16_t maxSpans = GLYPH_CACHE_SLOT_SIZE / sizeof(GlyphSpan);
+    uint16_t spanCount = 0;
+    uint16_t pixelCount = 0;
+
+    // Count first, as spans grow from the start of the slot and pixels are stored after the last span
+    for (uint8_t h = 0; h < fx->fontHeight; ++h)
+    {
+        uint8_t previous = 0;
+
+        for (uint16_t w = 0; w < glyph->width; ++w)
+        {
+            uint8_t level = shadeToLevel(fx->charDataPath[(fx->charDataWidth * h) + glyph->xPos + FONT_MYSTERIOUS_OFFSET + w]);
+            uint8_t kind = (level == 0) ? 0 : (level >= TEXT_BLEND_LEVELS) ? 1 : 2;
+
+            if (kind != 0) {
+                if (kind != previous) {
+                    ++spanCount;
+                }
+                ++pixelCount;
+            }
+            previous = kind;
+        }
+    }
+
+    if (glyph->width > UINT8_MAX || (spanCount * sizeof(GlyphSpan)) + (pixelCount * sizeof(uint16_t)) > GLYPH_CACHE_SLOT_SIZE || spanCount > maxSpans) {
+        return false;
+    }
+
+    GlyphSpan* spans = (GlyphSpan*)slot;
+    uint16_t* pixels = (uint16_t*)&spans[spanCount];
+    GlyphSpan* span = NULL;
+
+    spanCount = 0;
+
+    for (uint8_t h = 0; h < fx->fontHeight; ++h)
+    {
+        uint8_t previous = 0;
+
+        for (uint16_t w = 0; w < glyph->width; ++w)
+        {
+            uint8_t level = shadeToLevel(fx->charDataPath[(fx->charDataWidth * h) + glyph->xPos + FONT_MYSTERIOUS_OFFSET + w]);
+            uint8_t kind = (level == 0) ? 0 : (level >= TEXT_BLEND_LEVELS) ? 1 : 2;
+
+            if (kind != 0) {
+                if (kind != previous) {
+                    span = &spans[spanCount++];
+                    span->row = h;
+                    span->x = w;
+                    span->length = 0;
+                    span->flags = (kind == 2) ? GLYPH_SPAN_PARTIAL : 0;
+                }
+                ++span->length;
+                *pixels++ = (kind == 2) ? level : wireColour;
+            }
+            previous = kind;
+        }
+    }
+
+    entry->spanCount = spanCount;
+    return true;
+}
+
+// Returns the slot holding the glyph, rasterising it into the least recently used slot on a miss, or NULL if it cannot be cached
+static uint32_t* getCachedGlyph(TFT_t* dev, struct FontxFile* fx, const CharInfo* glyph, uint16_t colour, GlyphCacheEntry** entry)
+{
+    uint8_t victim = 0;
+
+    ++dev->_glyphCacheClock;
+
+    for (uint8_t i = 0; i < GLYPH_CACHE_SLOTS; ++i)
+    {
+        GlyphCacheEntry* candidate = &dev->_glyphCacheEntries[i];
+
+        if (candidate->lastUsed != 0 && candidate->fx == fx && candidate->colour == colour && candidate->ascii == glyph->ascii) {
+            candidate->lastUsed = dev->_glyphCacheClock;
+            ++dev->_glyphCacheStats.hits;
+            *entry = candidate;
+            return dev->_glyphCacheArena[i];
+        }
+
+        if (candidate->lastUsed < dev->_glyphCacheEntries[victim].lastUsed) {
+            victim = i;
+        }
+    }
+
+    ++dev->_glyphCacheStats.misses;
+
+    GlyphCacheEntry* slot = &dev->_glyphCacheEntries[victim];
+    bool evicting = (slot->lastUsed != 0);
+
+    // The slot is only overwritten once the glyph is known to fit
+    if (!rasteriseGlyphToSlot(fx, glyph, reverseBytes(colour), slot, dev->_glyphCacheArena[victim])) {
+        ++dev->_glyphCacheStats.uncacheable;
+        return NULL;
+    }
+
+    if (evicting) {
+        ++dev->_glyphCacheStats.evictions;
+    }
+
+    slot->fx = fx;
+    slot->colour = colour;
+    slot->ascii = glyph->ascii;
+    slot->lastUsed = dev->_glyphCacheClock;
+    *entry = slot;
+    return dev->_glyphCacheArena[victim];
+}
+
+void getGlyphCacheStats(TFT_t* dev, GlyphCacheStats* stats)
+{
+    *stats = dev->_glyphCacheStats;
+    stats->slotsUsed = 0;
+
+    for (uint8_t i = 0; i < GLYPH_CACHE_SLOTS; ++i)
+    {
+        if (dev->_glyphCacheEntries[i].lastUsed != 0) {
+            ++stats->slotsUsed;
+        }
+    }
+}
+
+void resetGlyphCache(TFT_t* dev)
+{
+    memset(dev->_glyphCacheEntries, 0, sizeof(dev->_glyphCacheEntries));
+    memset(&dev->_glyphCacheStats, 0, sizeof(dev->_glyphCacheStats));
+    dev->_glyphCacheClock = 0;
+}
+
+static inline uint16_t blendTextPixel(uint16_t wireBackground, const uint32_t* textShades, uint8_t level)
+{
+    uint32_t background = expandColour(reverseBytes(wireBackground));
+    uint32_t blended = (textShades[level] + (background * (TEXT_BLEND_LEVELS - level))) >> TEXT_BLEND_SHIFT;
+
+    return reverseBytes(compactColour(blended));
+}
+
+// Text colour scaled by every coverage level, so blending against the buffer is one multiply per pixel. Kept for the
+// last colour used, as every glyph of a text shares it.
+static const uint32_t* getTextShades(TFT_t* dev, uint16_t textColour)
+{
+    if (!dev->_textShadesValid || dev->_textShadesColour != textColour) {
+        uint32_t expandedText = expandColour(textColour);
+
+        for (uint8_t l = 0; l <= TEXT_BLEND_LEVELS; ++l)
+        {
+            dev->_textShades[l] = expandedText * l;
+        }
+        dev->_textShadesColour = textColour;
+        dev->_textShadesValid = true;
+    }
+    return dev->_textShades;
+}
+
+// Rasterises one glyph with its top left corner at x, y
+static void rasteriseGlyph(TFT_t* dev, const RenderTarget* target, struct FontxFile* fx, const CharInfo* glyph, uint16_t x, uint16_t y, uint16_t textColour)
+{
+    const uint32_t* textShades = getTextShades(dev, textColour);
+    GlyphCacheEntry* entry;
+    uint32_t* slot = getCachedGlyph(dev, fx, glyph, textColour, &entry);
+
+    if (slot != NULL) {
+        const GlyphSpan* spans = (const GlyphSpan*)slot;
+        const uint16_t* pixels = (const uint16_t*)&spans[entry->spanCount];
+
+        for (uint16_t s = 0; s < entry->spanCount; ++s)
+        {
+            uint16_t row = y + spans[s].row;
+            uint16_t start = x + spans[s].x;
+            uint16_t end = start + spans[s].length - 1;
+
+            if (row >= target->area.y1 && row <= target->area.y2 && end >= target->area.x1 && start <= target->area.x2) {
+                uint16_t skip = (start < target->area.x1) ? target->area.x1 - start : 0;
+                uint16_t length = ((end > target->area.x2) ? target->area.x2 : end) - (start + skip) + 1;
+                uint16_t* destination = targetPixel(target, start + skip, row);
+                const uint16_t* source = pixels + skip;
+
+                if (spans[s].flags & GLYPH_SPAN_PARTIAL) {
+                    for (uint16_t p = 0; p < length; ++p)
+                    {
+                        destination[p] = blendTextPixel(destination[p], textShades, source[p]);
+                    }
+                } else {
+                    spanCopy(destination, source, length);
+                }
+            }
+            pixels += spans[s].length;
+        }
+        return;
+    }
+
+    // Too large for a cache slot, so plot straight from the font
+    uint16_t wireTextColour = reverseBytes(textColour);
+    ScreenArea area = { x, y, x + glyph->width - 1, y + fx->fontHeight - 1 };
+
+    if (glyph->width == 0 || !clipToTarget(target, &area)) {
+        return;
+    }
+
+    for (uint16_t h = area.y1; h <= area.y2; ++h)
+    {
+        for (uint16_t w = area.x1; w <= area.x2; ++w)
+        {
+            uint8_t level = shadeToLevel(fx->charDataPath[(fx->charDataWidth * (h - y)) + glyph->xPos + FONT_MYSTERIOUS_OFFSET + (w - x)]);
+            uint16_t* destination = targetPixel(target, w, h);
+
+            if (level == 0) {
+                // Do nothing
+            } else if (level >= TEXT_BLEND_LEVELS) {
+                *destination = wireTextColour;
+            } else {
+                *destination = blendTextPixel(*destination, textShades, level);
+            }
+        }
+    }
+}
+
+// Display list
+// -------------
+
+// Draw calls are recorded and rasterised later, with every command clipped around the opaque commands drawn after it,
+// so each pixel is written once. The framebuffer resolves the list before sending; the strip renderer keeps it, as it
+// is the only copy of the screen.
+
+typedef enum DrawCommandType {
+    DRAW_FILL = 0,
+    DRAW_IMAGE,
+    DRAW_IMAGE_PART,
+    DRAW_COMPRESSED_IMAGE,
+    DRAW_INDEXED_IMAGE,
+    DRAW_GLYPH,
+    DRAW_ARC
+} DrawCommandType;
+
+static inline bool areaContains(const ScreenArea* outer, const ScreenArea* inner)
+{
+    return inner->x1 >= outer->x1 && inner->x2 <= outer->x2 && inner->y1 >= outer->y1 && inner->y2 <= outer->y2;
+}
+
+static inline bool areasIntersect(const ScreenArea* a, const ScreenArea* b)
+{
+    return a->x1 <= b->x2 && a->x2 >= b->x1 && a->y1 <= b->y2 && a->y2 >= b->y1;
+}
+
+static inline uint32_t areaPixels(const ScreenArea* area)
+{
+    return (uint32_t)(area->x2 - area->x1 + 1) * (area->y2 - area->y1 + 1);
+}
+
+// Glyphs are blended with what is under them, indexed images may have holes and arcs only cover part of their box,
+// everything else covers its whole area
+static inline bool commandIsOpaque(const DrawCommand* command)
+{
+    if (command->type == DRAW_INDEXED_IMAGE) {
+        return command->indexedImage->transparentIndex == INDEXED_IMAGE_OPAQUE;
+    }
+    return command->type != DRAW_GLYPH && command->type != DRAW_ARC;
+}
+
+// Whether later leaves nothing of earlier to show. An arc over a known background sets every pixel of its sector
+// whatever was there, so it hides the earlier arcs of the same ring within its angles.
+static inline bool commandHides(const DrawCommand* later, const DrawCommand* earlier)
+{
+    if (later->type == DRAW_ARC) {
+        return earlier->type == DRAW_ARC && (later->arcFlags & earlier->arcFlags & ARC_OVER_BACKGROUND)
+            && memcmp(&later->area, &earlier->area, sizeof(ScreenArea)) == 0
+            && later->outerRadius == earlier->outerRadius && later->innerRadius == earlier->innerRadius
+            && ((earlier->startAngle + 360 - later->startAngle) % 360) + earlier->sweep <= later->sweep;
+    }
+    return commandIsOpaque(later) && areaContains(&later->area, &earlier->area);
+}
+
+// Splits area into the up to four parts outside hole: full width bands above and below, then the sides
+static uint8_t subtractArea(const ScreenArea* area, const ScreenArea* hole, ScreenArea* parts)
+{
+    uint8_t count = 0;
+
+    if (!areasIntersect(area, hole)) {
+        parts[0] = *area;
+        return 1;
+    }
+
+    uint16_t y1 = area->y1;
+    uint16_t y2 = area->y2;
+
+    if (hole->y1 > area->y1) {
+        parts[count++] = (ScreenArea){ area->x1, area->y1, area->x2, hole->y1 - 1 };
+        y1 = hole->y1;
+    }
+    if (hole->y2 < area->y2) {
+        parts[count++] = (ScreenArea){ area->x1, hole->y2 + 1, area->x2, area->y2 };
+        y2 = hole->y2;
+    }
+    if (hole->x1 > area->x1) {
+        parts[count++] = (ScreenArea){ area->x1, y1, hole->x1 - 1, y2 };
+    }
+    if (hole->x2 < area->x2) {
+        parts[count++] = (ScreenArea){ hole->x2 + 1, y1, area->x2, y2 };
+    }
+    return count;
+}
+
+static void rasteriseCommand(TFT_t* dev, const RenderTarget* target, const DrawCommand* command)
+{
+    switch (command->type) {
+        case DRAW_FILL:
+            rasteriseFill(target, command->area, command->colour);
+            break;
+        case DRAW_IMAGE:
+            rasteriseImage(target, command->area.x1, command->area.y1, command->image);
+            break;
+        case DRAW_IMAGE_PART:
+            rasteriseImagePart(target, command->area, command->imageX, command->imageY, command->image);
+            break;
+        case DRAW_COMPRESSED_IMAGE:
+            rasteriseCompressedImage(target, command->area.x1, command->area.y1, command->compressedImage);
+            break;
+        case DRAW_INDEXED_IMAGE:
+            rasteriseIndexedImage(target, command->area.x1, command->area.y1, command->indexedImage);
+            break;
+        case DRAW_GLYPH: {
+            CharInfo glyph = { .ascii = command->ascii, .xPos = command->glyphXPos, .width = command->glyphWidth };
+            rasteriseGlyph(dev, target, command->fx, &glyph, command->area.x1, command->area.y1, command->colour);
+            break;
+        }
+        case DRAW_ARC:
+            rasteriseArc(dev, target, command);
+            break;
+    }
+}
+
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+
+// Fills map to one index and go straight into the buffer. Anything else is drawn over the expanded colours in a strip,
+// so it can blend with what is under it, then mapped back to the nearest palette entries.
+static void rasterisePiece(TFT_t* dev, const RenderTarget* target, const ScreenArea* piece, const DrawCommand* command)
+{
+    uint16_t width = piece->x2 - piece->x1 + 1;
+
+    if (command->type == DRAW_FILL) {
+        uint8_t index = nearestPaletteIndex(command->colour);
+
+        for (uint16_t h = piece->y1; h <= piece->y2; ++h)
+        {
+            memset(&dev->_buffer[(h * dev->_width) + piece->x1], index, width);
+        }
+        return;
+    }
+
+    uint16_t rowsPerStrip = STRIP_PIXELS / width;
+
+    for (uint16_t y = piece->y1; y <= piece->y2; y += rowsPerStrip)
+    {
+        uint16_t rows = (piece->y2 - y + 1) < rowsPerStrip ? (piece->y2 - y + 1) : rowsPerStrip;
+        RenderTarget strip = { dev->_stripBuffers[0], { piece->x1, y, piece->x2, y + rows - 1 }, width };
+
+        expandIndexedArea(dev, &strip);
+        rasteriseCommand(dev, &strip, command);
+
+        for (uint16_t h = 0; h < rows; ++h)
+        {
+            uint8_t* indices = &dev->_buffer[((y + h) * dev->_width) + piece->x1];
+            const uint16_t* colours = &strip.pixels[h * width];
+
+            for (uint16_t w = 0; w < width; ++w)
+            {
+                indices[w] = nearestPaletteIndex(colours[w]);
+            }
+        }
+    }
+}
+
+#else
+
+static inline void rasterisePiece(TFT_t* dev, const RenderTarget* target, const ScreenArea* piece, const DrawCommand* command)
+{
+    RenderTarget pieceTarget = { targetPixel(target, piece->x1, piece->y1), *piece, target->width };
+    rasteriseCommand(dev, &pieceTarget, command);
+}
+
+#endif
+
+// Rasterises the part of displayList[index] inside target that no later opaque command covers
+static void rasteriseVisible(TFT_t* dev, const RenderTarget* target, uint16_t index)
+{
+    ScreenArea pieces[SCREEN_DISPLAY_LIST_MAX_PIECES];
+    ScreenArea split[SCREEN_DISPLAY_LIST_MAX_PIECES];
+    uint8_t pieceCount = 1;
+    bool clipped = false;
+
+    pieces[0] = dev->_displayList[index].area;
+    if (!clipToTarget(target, &pieces[0])) {
+        return;
+    }
+
+    for (uint16_t i = index + 1; i < dev->_displayListLength && pieceCount > 0; ++i)
+    {
+        const ScreenArea* hole = &dev->_displayList[i].area;
+        uint8_t splitCount = 0;
+        bool overflow = false;
+
+        if (!commandIsOpaque(&dev->_displayList[i]) || !areasIntersect(hole, &target->area)) {
+            continue;
+        }
+
+        for (uint8_t p = 0; p < pieceCount && !overflow; ++p)
+        {
+            ScreenArea parts[4];
+            uint8_t partCount = subtractArea(&pieces[p], hole, parts);
+
+            if (splitCount + partCount > SCREEN_DISPLAY_LIST_MAX_PIECES) {
+                overflow = true;
+            } else {
+                memcpy(&split[splitCount], parts, partCount * sizeof(ScreenArea));
+                splitCount += partCount;
+            }
+        }
+
+        // Too fragmented to track, so draw what is left and let the later commands paint over it
+        if (overflow) {
+            break;
+        }
+
+        if (splitCount != pieceCount || memcmp(split, pieces, splitCount * sizeof(ScreenArea)) != 0) {
+            clipped = true;
+        }
+        memcpy(pieces, split, splitCount * sizeof(ScreenArea));
+        pieceCount = splitCount;
+    }
+
+    if (pieceCount == 0) {
+        ++dev->_renderStats.culled;
+        return;
+    } else if (clipped) {
+        ++dev->_renderStats.clipped;
+    }
+
+    for (uint8_t p = 0; p < pieceCount; ++p)
+    {
+        rasterisePiece(dev, target, &pieces[p], &dev->_displayList[index]);
+        dev->_renderStats.pixelsWritten += areaPixels(&pieces[p]);
+    }
+}
+
+static void renderDisplayList(TFT_t* dev, const RenderTarget* target)
+{
+    for (uint16_t i = 0; i < dev->_displayListLength; ++i)
+    {
+        rasteriseVisible(dev, target, i);
+    }
+}
+
+#if defined(SCREEN_STRIP_RENDERER)
+
+// Replays the display list into target, which starts out black like a fresh screen buffer
+static void renderTarget(TFT_t* dev, const RenderTarget* target)
+{
+    uint16_t rows = target->area.y2 - target->area.y1 + 1;
+
+    memset(target->pixels, 0, target->width * rows * sizeof(uint16_t));
+    renderDisplayList(dev, target);
+}
+
+#elif defined(SCREEN_INDEXED_FRAMEBUFFER)
+
+static inline void renderTarget(TFT_t* dev, const RenderTarget* target)
+{
+    expandIndexedArea(dev, target);
+}
+
+#endif
+
+#if defined(SCREEN_STRIP_RENDERER) || defined(SCREEN_INDEXED_FRAMEBUFFER)
+
+// Rasterises the area a strip at a time into alternating buffers, so rendering one strip overlaps sending the previous one.
+// The address window must already be set. lastFlags go on the final transaction.
+static bool sendAreaInStrips(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint32_t lastFlags)
+{
+    uint16_t width = x2 - x1 + 1;
+    uint16_t rowsPerStrip = STRIP_PIXELS / width;
+    uint8_t queued[2] = { 0, 0 };
+    uint8_t transaction = 0;
+    uint8_t strip = 0;
+
+    for (uint16_t y = y1; y <= y2; y += rowsPerStrip)
+    {
+        uint8_t buffer = strip++ % 2;
+        uint16_t rows = (y2 - y + 1) < rowsPerStrip ? (y2 - y + 1) : rowsPerStrip;
+
+        // Transactions complete in order, so once only the other buffer's are left this one is free
+        if (!collectTransactions(dev, queued[buffer ^ 1])) {
+            return false;
+        }
+        queued[buffer] = 0;
+
+        RenderTarget target = { dev->_stripBuffers[buffer], { x1, y, x2, y + rows - 1 }, width };
+        uint32_t renderStart = perfNow();
+
+        renderTarget(dev, &target);
+        perfAddRasterise(dev, renderStart);
+
+        uint32_t stripBytes = (uint32_t)width * rows * 2;
+
+        for (uint32_t sent = 0; sent < stripBytes; sent += SCREEN_MAX_TRANSMISSION_BUFFER)
+        {
+            uint32_t length = (stripBytes - sent) < SCREEN_MAX_TRANSMISSION_BUFFER ? (stripBytes - sent) : SCREEN_MAX_TRANSMISSION_BUFFER;
+            uint32_t flags = (y + rows > y2 && sent + length == stripBytes) ? lastFlags : 0;
+
+            if (!queueBytesToScreen(dev, &dev->_stripTransactions[transaction++ % MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND], (uint8_t*)dev->_stripBuffers[buffer] + sent, length, flags)) {
+                return false;
+            }
+            ++queued[buffer];
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+#ifndef SCREEN_STRIP_RENDERER
+
+// Rasterises everything recorded so far into the screen buffer
+static void resolveDisplayList(TFT_t* dev)
+{
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+    // Only bounds the display list; the pixels are indices in the screen buffer and drawn through a strip, see rasterisePiece
+    RenderTarget frameTarget = { NULL, { 0, 0, dev->_width - 1, dev->_height - 1 }, dev->_width };
+
+    // The first strip buffer is the scratch space, so an asynchronous send must be done with it
+    if (dev->_displayListLength > 0) {
+        waitForTransmission(dev);
+    }
+#else
+    RenderTarget frameTarget = { dev->_buffer, { 0, 0, dev->_width - 1, dev->_height - 1 }, dev->_width };
+#endif
+    uint32_t renderStart = perfNow();
+
+    renderDisplayList(dev, &frameTarget);
+    dev->_displayListLength = 0;
+    perfAddRasterise(dev, renderStart);
+}
+
+// Drops everything recorded so far, for when the whole buffer is about to be overwritten
+static void discardDisplayList(TFT_t* dev)
+{
+    dev->_renderStats.dropped += dev->_displayListLength;
+    dev->_displayListLength = 0;
+}
+
+#endif
+
+static bool recordCommand(TFT_t* dev, const DrawCommand* command)
+{
+    ScreenArea onScreen = {
+        .x1 = command->area.x1,
+        .y1 = command->area.y1,
+        .x2 = command->area.x2 < dev->_width ? command->area.x2 : dev->_width - 1,
+        .y2 = command->area.y2 < dev->_height ? command->area.y2 : dev->_height - 1
+    };
+
+    ++dev->_renderStats.recorded;
+    if (onScreen.x1 <= onScreen.x2 && onScreen.y1 <= onScreen.y2) {
+        dev->_renderStats.pixelsSubmitted += areaPixels(&onScreen);
+    }
+
+    // Anything entirely under an opaque command can never show again, which also keeps redrawn widgets from filling the list
+    if (commandIsOpaque(command) || command->type == DRAW_ARC) {
+        uint16_t kept = 0;
+
+        for (uint16_t i = 0; i < dev->_displayListLength; ++i)
+        {
+            if (!commandHides(command, &dev->_displayList[i])) {
+                dev->_displayList[kept++] = dev->_displayList[i];
+            }
+        }
+        dev->_renderStats.dropped += dev->_displayListLength - kept;
+        dev->_displayListLength = kept;
+    }
+
+    if (dev->_displayListLength == SCREEN_DISPLAY_LIST_SIZE) {
+#ifdef SCREEN_STRIP_RENDERER
+        ERROR("Display list full! Increase SCREEN_DISPLAY_LIST_SIZE from %i", SCREEN_DISPLAY_LIST_SIZE);
+        return false;
+#else
+        resolveDisplayList(dev);
+#endif
+    }
+
+    dev->_displayList[dev->_displayListLength++] = *command;
+    return true;
+}
+
+static bool drawFill(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t wireColour)
+{
+    DrawCommand command = { .area = { x1, y1, x2, y2 }, .type = DRAW_FILL, .colour = wireColour };
+    return recordCommand(dev, &command);
+}
+
+static bool drawImage(TFT_t* dev, uint16_t x, uint16_t y, const struct Image* image)
+{
+    DrawCommand command = { .area = { x, y, x + image->width - 1, y + image->height - 1 }, .type = DRAW_IMAGE, .image = image };
+    return recordCommand(dev, &command);
+}
+
+static bool drawImagePart(TFT_t* dev, const ScreenArea* area, uint16_t x, uint16_t y, const struct Image* image)
+{
+    DrawCommand command = { .area = *area, .type = DRAW_IMAGE_PART, .imageX = x, .imageY = y, .image = image };
+    return recordCommand(dev, &command);
+}
+
+static bool drawCompressedImage(TFT_t* dev, uint16_t x, uint16_t y, const CompressedImage* image)
+{
+    DrawCommand command = { .area = { x, y, x + image->width - 1, y + image->height - 1 }, .type = DRAW_COMPRESSED_IMAGE, .compressedImage = image };
+    return recordCommand(dev, &command);
+}
+
+static bool drawIndexedImage(TFT_t* dev, uint16_t x, uint16_t y, const IndexedImage* image)
+{
+    DrawCommand command = { .area = { x, y, x + image->width - 1, y + image->height - 1 }, .type = DRAW_INDEXED_IMAGE, .indexedImage = image };
+    return recordCommand(dev, &command);
+}
+
+static bool drawGlyph(TFT_t* dev, struct FontxFile* fx, const CharInfo* glyph, uint16_t x, uint16_t y, uint16_t textColour)
+{
+    if (glyph->width == 0) {
+        return true;
+    }
+
+    DrawCommand command = {
+        .area = { x, y, x + glyph->width - 1, y + fx->fontHeight - 1 },
+        .type = DRAW_GLYPH,
+        .ascii = glyph->ascii,
+        .colour = textColour,
+        .glyphXPos = glyph->xPos,
+        .glyphWidth = glyph->width,
+        .fx = fx
+    };
+    return recordCommand(dev, &command);
+}
+
+static bool drawArc(TFT_t* dev, uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t startAngle, uint16_t sweep, uint16_t wireColour, uint8_t flags, uint16_t wireBackground)
+{
+    DrawCommand command = {
+        .area = { centerX - outerRadius, centerY - outerRadius, centerX + outerRadius, centerY + outerRadius },
+        .type = DRAW_ARC,
+        .arcFlags = flags,
+        .colour = wireColour,
+        .startAngle = startAngle % 360,
+        .sweep = sweep,
+        .outerRadius = outerRadius,
+        .innerRadius = innerRadius,
+        .arcBackground = wireBackground
+    };
+    return recordCommand(dev, &command);
+}
+
+void getRenderStats(TFT_t* dev, RenderStats* stats)
+{
+    *stats = dev->_renderStats;
+}
+
+void resetRenderStats(TFT_t* dev)
+{
+    memset(&dev->_renderStats, 0, sizeof(RenderStats));
+}
+
+// Text
+// -----
+
+// Looks up every char and places it, relative to the start of the text. Each char owns a cell, which for normalized
+// digits is at least as wide as the glyph itself. Returns the total text width.
+static uint16_t layoutText(const char* text, uint16_t textLenght, uint8_t spacing, bool normalizedWidth, struct FontxFile* fx, CharInfo* chars, uint16_t* glyphX, uint16_t* cellX, uint16_t* cellWidth)
+{
+    uint16_t charDesiredWidth = 0;
+    if (normalizedWidth) {
+        charDesiredWidth = fx->numbersNormalizedWidth;
+    }
+
+    uint16_t textWidth = 0;
+
+    for (uint16_t c = 0; c < textLenght; ++c)
+    {
+        chars[c].ascii = text[c];
+        getChar(fx, text[c], &chars[c].xPos, &chars[c].width, &chars[c].xOffset);
+
+        if (c != 0) {
+            textWidth += spacing;
+        }
+        cellX[c] = textWidth;
+
+        // Normalized digits are centred in their cell, rounding the left padding up. A glyph wider than the normalized
+        // width gets a cell of its own width, so erasing a cell always erases all of its glyph.
+        if (normalizedWidth && (chars[c].ascii >= 48 && chars[c].ascii <= 57)) {
+            uint16_t padding = (charDesiredWidth > chars[c].width) ? charDesiredWidth - chars[c].width : 0;
+
+            glyphX[c] = textWidth + (padding / 2) + (padding % 2);
+            cellWidth[c] = (charDesiredWidth > chars[c].width) ? charDesiredWidth : chars[c].width;
+        } else {
+            glyphX[c] = textWidth;
+            cellWidth[c] = chars[c].width;
+        }
+        textWidth += cellWidth[c];
+    }
+
+    return textWidth;
+}
+
+static bool prepareFont(struct FontxFile* fx)
+{
+    if (!fx->opened) {
+        if (!openFont(fx)){
+            LOG_ERROR("Could not open font %s", fx->fontName);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool writeText(TFT_t* dev, char* text, uint8_t spacing, bool normalizedWidth, struct FontxFile *fx, uint16_t x, uint16_t y, uint16_t textColour)
+{
+    // STATUS("\nWrite text called!\n");
+
+    if (text == NULL) {
+        ERROR("writeText called with empty or unintialized string!");
+        return false;
+    }
+    prepareFont(fx);
+
+    // Char processing
+    // ----------------
+
+    uint16_t textLenght = strlen(text);
+    // LOG("Text size: %i", textLenght);
+
+    if (textLenght > WRITE_TEXT_BUFFER) {
+        LOG_ERROR("Text size longer than buffer! Increase buffer from %i to at least %i to write thi text.", WRITE_TEXT_BUFFER, textLenght);
+        return false;
+    } else if (textLenght == 0) {
+        return true;
+    }
+
+    CharInfo chars[WRITE_TEXT_BUFFER];
+    uint16_t glyphX[WRITE_TEXT_BUFFER];
+    uint16_t cellX[WRITE_TEXT_BUFFER];
+    uint16_t cellWidth[WRITE_TEXT_BUFFER];
+
+    uint16_t textWidth = layoutText(text, textLenght, spacing, normalizedWidth, fx, chars, glyphX, cellX, cellWidth);
+
+    // Position processing
+    // --------------------
+
+    uint16_t startX = x - (textWidth / 2);
+
+    if (startX + textWidth > dev->_width || y + fx->fontHeight > dev->_height) {
+        ERROR("Text outside screen bounds");
+        return false;
+    }
+
+    // Plotting into buffer
+    // ---------------------
+
+    for (uint16_t c = 0; c < textLenght; ++c)
+    {
+        if (!drawGlyph(dev, fx, &chars[c], startX + glyphX[c], y, toNativeColour(textColour))) {
+            return false;
+        }
+    }
+
+    markBufferAreaDirty(dev, startX, y, startX + textWidth - 1, y + fx->fontHeight - 1);
+    return true;
+}
+
+// Text labels
+// ------------
+
+void initTextLabel(TextLabel* label, struct FontxFile* fx, uint16_t x, uint16_t y, uint8_t spacing, bool normalizedWidth, uint16_t textColour, uint16_t backgroundColour)
+{
+    memset(label, 0, sizeof(TextLabel));
+    label->fx = fx;
+    label->x = x;
+    label->y = y;
+    label->spacing = spacing;
+    label->normalizedWidth = normalizedWidth;
+    label->textColour = textColour;
+    label->backgroundColour = backgroundColour;
+}
+
+static void addLabelChangedArea(TextLabel* label, uint16_t x1, uint16_t x2)
+{
+    // Neighbouring cells share a row, so they are cheaper to send as one window
+    if (label->changedAreaCount > 0 && x1 <= label->changedAreas[label->changedAreaCount - 1].x2 + 1 + label->spacing) {
+        label->changedAreas[label->changedAreaCount - 1].x2 = x2;
+        return;
+    }
+
+    ScreenArea area = { x1, label->y, x2, label->y + label->fx->fontHeight - 1 };
+    label->changedAreas[label->changedAreaCount++] = area;
+}
+
+bool updateTextLabel(TFT_t* dev, TextLabel* label, const char* text)
+{
+    if (text == NULL) {
+        ERROR("updateTextLabel called with uninitialized string!");
+        return false;
+    }
+    if (!prepareFont(label->fx)) {
+        return false;
+    }
+
+    uint16_t textLenght = strlen(text);
+
+    if (textLenght > TEXT_LABEL_MAX_LENGTH) {
+        ERROR("Label text longer than %i characters", TEXT_LABEL_MAX_LENGTH);
+        return false;
+    }
+
+    CharInfo chars[TEXT_LABEL_MAX_LENGTH];
+    uint16_t glyphX[TEXT_LABEL_MAX_LENGTH];
+    uint16_t cellX[TEXT_LABEL_MAX_LENGTH];
+    uint16_t cellWidth[TEXT_LABEL_MAX_LENGTH];
+
+    uint16_t textWidth = layoutText(text, textLenght, label->spacing, label->normalizedWidth, label->fx, chars, glyphX, cellX, cellWidth);
+    uint16_t startX = label->x - (textWidth / 2);
+    uint16_t bottomY = label->y + label->fx->fontHeight;
+
+    if (startX + textWidth > dev->_width || bottomY > dev->_height) {
+        ERROR("Label outside screen bounds");
+        return false;
+    }
+
+    // Same cells as last time means only the chars that differ need redrawing
+    bool sameCells = label->drawn && textLenght == label->length && startX == label->startX;
+
+    for (uint16_t c = 0; c < textLenght && sameCells; ++c)
+    {
+        sameCells = (cellX[c] == label->cellX[c] && cellWidth[c] == label->cellWidth[c]);
+    }
+
+    label->changedAreaCount = 0;
+
+    if (sameCells) {
+        for (uint16_t c = 0; c < textLenght; ++c)
+        {
+            if (text[c] == label->text[c]) {
+                continue;
+            }
+
+            uint16_t cellStart = startX + cellX[c];
+
+            fillBufferAreaWithColour(dev, cellStart, label->y, cellStart + cellWidth[c], bottomY, label->backgroundColour);
+            drawGlyph(dev, label->fx, &chars[c], startX + glyphX[c], label->y, toNativeColour(label->textColour));
+            addLabelChangedArea(label, cellStart, cellStart + cellWidth[c] - 1);
+        }
+    } else {
+        // Layout moved, so clear whatever the old text covered and draw everything
+        uint16_t x1 = startX;
+        uint16_t x2 = startX + textWidth;
+
+        if (label->drawn && label->width > 0) {
+            x1 = (label->startX < x1) ? label->startX : x1;
+            x2 = (label->startX + label->width > x2) ? label->startX + label->width : x2;
+        }
+
+        if (x2 > x1) {
+            fillBufferAreaWithColour(dev, x1, label->y, x2, bottomY, label->backgroundColour);
+
+            for (uint16_t c = 0; c < textLenght; ++c)
+            {
+                drawGlyph(dev, label->fx, &chars[c], startX + glyphX[c], label->y, toNativeColour(label->textColour));
+            }
+            addLabelChangedArea(label, x1, x2 - 1);
+        }
+    }
+
+    memcpy(label->text, text, textLenght + 1);
+    memcpy(label->cellX, cellX, textLenght * sizeof(uint16_t));
+    memcpy(label->cellWidth, cellWidth, textLenght * sizeof(uint16_t));
+    label->length = textLenght;
+    label->startX = startX;
+    label->width = textWidth;
+    label->drawn = true;
+
+    return true;
+}
+
+// Progress bars
+// --------------
+
+void initProgressBar(ProgressBar* bar, uint16_t centerX, uint16_t centerY, uint16_t length, uint8_t thickness, const struct Image* background, uint16_t backgroundColour, uint16_t colour, uint16_t edgeColour)
+{
+    memset(bar, 0, sizeof(ProgressBar));
+    bar->background = background;
+    bar->backgroundColour = backgroundColour;
+    bar->colour = colour;
+    bar->edgeColour = edgeColour;
+    bar->width = (background != NULL) ? background->width : length;
+    bar->height = (background != NULL) ? background->height : thickness;
+    bar->x = centerX - (bar->width / 2);
+    bar->y = centerY - (bar->height / 2);
+    bar->barX = bar->x + ((bar->width - length) / 2);
+    bar->barY = bar->y + ((bar->height - thickness) / 2);
+    bar->length = length;
+    bar->thickness = thickness;
+}
+
+// Fills columns x1 to x2 of rows y1 to y2, all inclusive, keeping to the columns of clip
+static bool drawBarFill(TFT_t* dev, const ScreenArea* clip, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t wireColour)
+{
+    x1 = (x1 > clip->x1) ? x1 : clip->x1;
+    x2 = (x2 < clip->x2) ? x2 : clip->x2;
+
+    if (x1 > x2) {
+        return true;
+    }
+    return drawFill(dev, x1, y1, x2, y2, wireColour);
+}
+
+// The bar inside the columns of clip, over its background. Each end is slanted over the top and bottom thirds of the
+// rows, with an edge pixel on either side of every slanted row. Only the right end moves with progress.
+static bool drawProgressBar(TFT_t* dev, const ProgressBar* bar, uint16_t pixelProgress, const ScreenArea* clip)
+{
+    uint16_t colour = toWireColour(bar->colour);
+    uint16_t light = toWireColour(bar->edgeColour);
+    uint8_t angle = bar->thickness / 3;
+    uint8_t midsection = bar->thickness - (angle * 2);
+    bool drawn = true;
+
+    if (bar->background == NULL) {
+        drawn &= drawFill(dev, clip->x1, clip->y1, clip->x2, clip->y2, toWireColour(bar->backgroundColour));
+    } else if (areaPixels(clip) == (uint32_t)bar->width * bar->height) {
+        drawn &= drawImage(dev, bar->x, bar->y, bar->background);
+    } else {
+        drawn &= drawImagePart(dev, clip, bar->x, bar->y, bar->background);
+    }
+
+    // Middle section
+    drawn &= drawBarFill(dev, clip, bar->barX, bar->barY + angle, bar->barX + pixelProgress + (angle * 2) - 1, bar->barY + angle + midsection - 1, colour);
+
+    // Top and bottom sections, k rows in from the outside
+    for (uint8_t h = 0; h < bar->thickness; ++h)
+    {
+        if (h >= angle && h < angle + midsection) {
+            continue;
+        }
+
+        bool top = h < angle;
+        uint8_t k = top ? h : bar->thickness - 1 - h;
+        uint16_t edge = (h == (top ? angle / 2 : angle + midsection + (angle / 2))) ? colour : light;
+        uint16_t y = bar->barY + h;
+
+        drawn &= drawBarFill(dev, clip, bar->barX + angle - k - 1, y, bar->barX + angle - k - 1, y, edge);
+        drawn &= drawBarFill(dev, clip, bar->barX + angle - k, y, bar->barX + angle + pixelProgress + k - 1, y, colour);
+        drawn &= drawBarFill(dev, clip, bar->barX + angle + pixelProgress + k, y, bar->barX + angle + pixelProgress + k, y, edge);
+    }
+
+    return drawn;
+}
+
+bool updateProgressBar(TFT_t* dev, ProgressBar* bar, uint32_t value, uint32_t total)
+{
+    uint8_t angle = bar->thickness / 3;
+
+    if (bar->x + bar->width > dev->_width || bar->y + bar->height > dev->_height) {
+        ERROR("Progress bar outside screen bounds");
+        return false;
+    } else if (bar->length > bar->width || bar->thickness > bar->height) {
+        ERROR("Progress bar larger than its background");
+        return false;
+    } else if (bar->length <= (angle * 2) + 2) {
+        ERROR("Progress bar too short");
+        return false;
+    }
+
+    uint32_t filled = (total == 0 || value >= total) ? bar->length : (uint32_t)(((uint64_t)bar->length * value) / total);
+    uint16_t pixelProgress = (filled <= (angle * 2) + 1u) ? 2 : filled - (angle * 2);
+    ScreenArea whole = { bar->x, bar->y, bar->x + bar->width - 1, bar->y + bar->height - 1 };
+
+    bar->changedArea = (ScreenArea){ 1, 0, 0, 0 };
+
+    if (bar->drawn && pixelProgress == bar->pixelProgress) {
+        return true;
+    }
+
+    if (!bar->drawn) {
+        bar->changedArea = whole;
+    } else {
+        // Between the old and new ends, from where the slant of the shorter one starts to where the longer one ends
+        uint16_t shorter = (pixelProgress < bar->pixelProgress) ? pixelProgress : bar->pixelProgress;
+        uint16_t longer = (pixelProgress < bar->pixelProgress) ? bar->pixelProgress : pixelProgress;
+
+        bar->changedArea = (ScreenArea){ bar->barX + shorter + angle, bar->barY, bar->barX + longer + (angle * 2) - 1, bar->barY + bar->thickness - 1 };
+    }
+
+#ifdef SCREEN_STRIP_RENDERER
+    // Nothing is rasterised before it is sent, so recording the whole bar again costs little, and drops the commands
+    // the last update left in the display list
+    const ScreenArea* clip = &whole;
+#else
+    const ScreenArea* clip = &bar->changedArea;
+#endif
+
+    if (!drawProgressBar(dev, bar, pixelProgress, clip)) {
+        ERROR("Could not draw progress bar");
+        return false;
+    }
+
+    markBufferAreaDirty(dev, bar->changedArea.x1, bar->changedArea.y1, bar->changedArea.x2, bar->changedArea.y2);
+    bar->pixelProgress = pixelProgress;
+    bar->drawn = true;
+    return true;
+}
+
+static ProgressBar* findLoadingBar(TFT_t* dev, uint16_t centerX, uint16_t centerY)
+{
+    LoadingBar* slot = NULL;
+
+    for (uint8_t i = 0; i < SCREEN_LOADING_BARS && slot == NULL; ++i)
+    {
+        LoadingBar* candidate = &dev->_loadingBars[i];
+
+        if (candidate->used && candidate->centerX == centerX && candidate->centerY == centerY) {
+            slot = candidate;
+        }
+    }
+
+    if (slot == NULL) {
+        slot = &dev->_loadingBars[dev->_nextLoadingBar];
+        dev->_nextLoadingBar = (dev->_nextLoadingBar + 1) % SCREEN_LOADING_BARS;
+
+        slot->used = true;
+        slot->centerX = centerX;
+        slot->centerY = centerY;
+        slot->bufferClears = dev->_bufferClears;
+        initProgressBar(&slot->bar, centerX, centerY, 160, 10, &loadingBarBackground, 0, SCREEN_COLOUR(BLACK), SCREEN_COLOUR(BLACK | 0x8410));
+    }
+
+    // Whatever was under the bar is gone, so it has to be drawn in full
+    if (slot->bufferClears != dev->_bufferClears) {
+        slot->bufferClears = dev->_bufferClears;
+        slot->bar.drawn = false;
+    }
+    return &slot->bar;
+}
+
+bool loadingBar(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable)
+{
+    uint32_t value;
+    uint32_t total;
+
+    // Progress from the linked variable
+    if (variable == (intptr_t)&brewElapsedTime) {
+        value = brewElapsedTime;
+        total = brewOrder.brewTime * 1000;
+    } else if (variable == (intptr_t)&fakeLoadingValue) {
+        value = fakeLoadingValue;
+        total = 100;
+    } else {
+        ERROR("Invalid variable link in loadingBar");
+        return false;
+    }
+
+    ProgressBar* bar = findLoadingBar(dev, centerX, centerY);
+
+    if (!updateProgressBar(dev, bar, value, total)) {
+        return false;
+    }
+
+    if (bar->changedArea.x1 <= bar->changedArea.x2 && !sendBufferArea(dev, bar->changedArea.x1, bar->changedArea.y1, bar->changedArea.x2, bar->changedArea.y2)) {
+        ERROR("Could not send buffer to screen");
+        return false;
+    }
+    return true;
+}
+
+// Loading circles
+// ----------------
+
+void initLoadingCircle(LoadingCircle* circle, uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t colour, uint16_t trackColour, uint16_t backgroundColour)
+{
+    memset(circle, 0, sizeof(LoadingCircle));
+    circle->centerX = centerX;
+    circle->centerY = centerY;
+    circle->outerRadius = outerRadius;
+    circle->innerRadius = innerRadius;
+    circle->colour = colour;
+    circle->trackColour = trackColour;
+    circle->backgroundColour = backgroundColour;
+}
+
+static inline bool circleHighlights(uint16_t startAngle, uint16_t sweep, uint16_t angle)
+{
+    return sweep > 0 && angleInSector(angle, startAngle, sweep);
+}
+
+static inline ScreenArea circleArea(const LoadingCircle* circle)
+{
+    return (ScreenArea){ circle->centerX - circle->outerRadius, circle->centerY - circle->outerRadius, circle->centerX + circle->outerRadius, circle->centerY + circle->outerRadius };
+}
+
+// Adds the boxes around a sector to the changed areas, falling back to the box around the whole circle once they run out
+static void addCircleChangedArea(LoadingCircle* circle, uint16_t startAngle, uint16_t sweep)
+{
+    ScreenArea whole = circleArea(circle);
+    ScreenArea areas[5];
+
+    if (circle->changedAreaCount == 1 && memcmp(&circle->changedAreas[0], &whole, sizeof(ScreenArea)) == 0) {
+        return;
+    }
+
+    uint8_t areaCount = arcSectorAreas(circle->centerX, circle->centerY, circle->outerRadius, circle->innerRadius, startAngle, sweep, areas);
+
+    if (circle->changedAreaCount + areaCount > LOADING_CIRCLE_MAX_CHANGED_AREAS) {
+        circle->changedAreas[0] = whole;
+        circle->changedAreaCount = 1;
+    } else {
+        memcpy(&circle->changedAreas[circle->changedAreaCount], areas, areaCount * sizeof(ScreenArea));
+        circle->changedAreaCount += areaCount;
+    }
+}
+
+bool updateLoadingCircle(TFT_t* dev, LoadingCircle* circle, uint16_t startAngle, uint16_t sweep)
+{
+    uint16_t outer = circle->outerRadius;
+    ScreenArea whole = circleArea(circle);
+
+    if (circle->centerX < outer || circle->centerY < outer || whole.x2 >= dev->_width || whole.y2 >= dev->_height) {
+        ERROR("Loading circle outside screen bounds");
+        return false;
+    } else if (circle->innerRadius >= outer) {
+        ERROR("Invalid loading circle");
+        return false;
+    }
+
+    uint16_t colour = toWireColour(circle->colour);
+    uint16_t track = toWireColour(circle->trackColour);
+    uint16_t background = toWireColour(circle->backgroundColour);
+    bool drawn = true;
+
+    startAngle %= 360;
+    sweep = (sweep < 360) ? sweep : 360;
+    circle->changedAreaCount = 0;
+
+    if (!circle->drawn) {
+        drawn &= drawFill(dev, whole.x1, whole.y1, whole.x2, whole.y2, background);
+        drawn &= drawArc(dev, circle->centerX, circle->centerY, outer, circle->innerRadius, 0, 360, track, ARC_OVER_BACKGROUND, background);
+        if (sweep > 0) {
+            drawn &= drawArc(dev, circle->centerX, circle->centerY, outer, circle->innerRadius, startAngle, sweep, colour, ARC_OVER_BACKGROUND, background);
+        }
+        circle->changedAreas[0] = whole;
+        circle->changedAreaCount = 1;
+    } else {
+        // Runs of degrees that changed to the same state. The walk starts where a run cannot carry on from the degree
+        // before, so none is split at 0.
+        uint16_t origin = 0;
+
+        for (uint16_t d = 0; d < 360; ++d)
+        {
+            uint16_t before = (d + 359) % 360;
+            bool highlighted = circleHighlights(startAngle, sweep, d);
+            bool changed = highlighted != circleHighlights(circle->startAngle, circle->sweep, d);
+            bool changedBefore = circleHighlights(startAngle, sweep, before) != circleHighlights(circle->startAngle, circle->sweep, before);
+
+            if (!changed || !changedBefore || highlighted != circleHighlights(startAngle, sweep, before)) {
+                origin = d;
+                break;
+            }
+        }
+
+        for (uint16_t d = 0; d < 360;)
+        {
+            uint16_t angle = (origin + d) % 360;
+            bool highlighted = circleHighlights(startAngle, sweep, angle);
+            uint16_t run = 0;
+
+            while (d + run < 360) {
+                uint16_t next = (origin + d + run) % 360;
+                bool nextHighlighted = circleHighlights(startAngle, sweep, next);
+
+                if (nextHighlighted == circleHighlights(circle->startAngle, circle->sweep, next) || nextHighlighted != highlighted) {
+                    break;
+                }
+                ++run;
+            }
+
+            if (run == 0) {
+                ++d;
+                continue;
+            }
+
+#ifndef SCREEN_STRIP_RENDERER
+            drawn &= drawArc(dev, circle->centerX, circle->centerY, outer, circle->innerRadius, angle, run, highlighted ? colour : track, ARC_OVER_BACKGROUND, background);
+#endif
+            addCircleChangedArea(circle, angle, run);
+            d += run;
+        }
+
+#ifdef SCREEN_STRIP_RENDERER
+        // Nothing is rasterised before it is sent, so recording the whole ring again costs little, and drops the arcs
+        // the last update left in the display list
+        if (circle->changedAreaCount > 0) {
+            drawn &= drawArc(dev, circle->centerX, circle->centerY, outer, circle->innerRadius, 0, 360, track, ARC_OVER_BACKGROUND, background);
+            if (sweep > 0) {
+                drawn &= drawArc(dev, circle->centerX, circle->centerY, outer, circle->innerRadius, startAngle, sweep, colour, ARC_OVER_BACKGROUND, background);
+            }
+        }
+#endif
+    }
+
+    if (!drawn) {
+        ERROR("Could not draw loading circle");
+        return false;
+    }
+
+    for (uint8_t a = 0; a < circle->changedAreaCount; ++a)
+    {
+        markBufferAreaDirty(dev, circle->changedAreas[a].x1, circle->changedAreas[a].y1, circle->changedAreas[a].x2, circle->changedAreas[a].y2);
+    }
+    circle->startAngle = startAngle;
+    circle->sweep = sweep;
+    circle->drawn = true;
+    return true;
+}
+
+static LoadingCircle* findLoadingCircle(TFT_t* dev, uint16_t centerX, uint16_t centerY)
+{
+    ProcessLoadingCircle* slot = NULL;
+
+    for (uint8_t i = 0; i < SCREEN_LOADING_CIRCLES && slot == NULL; ++i)
+    {
+        ProcessLoadingCircle* candidate = &dev->_loadingCircles[i];
+
+        if (candidate->used && candidate->centerX == centerX && candidate->centerY == centerY) {
+            slot = candidate;
+        }
+    }
+
+    if (slot == NULL) {
+        slot = &dev->_loadingCircles[dev->_nextLoadingCircle];
+        dev->_nextLoadingCircle = (dev->_nextLoadingCircle + 1) % SCREEN_LOADING_CIRCLES;
+
+        slot->used = true;
+        slot->centerX = centerX;
+        slot->centerY = centerY;
+        slot->bufferClears = dev->_bufferClears;
+
+        // Diameter 120
+        initLoadingCircle(&slot->circle, centerX, centerY, 60, 50, SCREEN_COLOUR(BLACK), SCREEN_COLOUR(LIGHTGREY), SCREEN_COLOUR(WHITE));
+    }
+
+    // Whatever was under the circle is gone, so it has to be drawn in full
+    if (slot->bufferClears != dev->_bufferClears) {
+        slot->bufferClears = dev->_bufferClears;
+        slot->circle.drawn = false;
+    }
+    return &slot->circle;
+}
+
+bool brewingAnimation(TFT_t* dev, uint16_t centerX, uint16_t centerY, uint8_t stage)
+{
+    // uint8_t y_drop_limit;
+
+    // How many stages? (Frame)
+
+    // Calculate where to place drop based on stage
+
+    // Load static machine and cup image
+
+    return true;
+}
+
+bool processLoadingCircle(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable)
+{
+    uint32_t value;
+    uint32_t total;
+
+    // Progress from the linked variable
+    if (variable == (intptr_t)&brewElapsedTime) {
+        value = brewElapsedTime;
+        total = brewOrder.brewTime * 1000;
+    } else if (variable == (intptr_t)&fakeLoadingValue) {
+        value = fakeLoadingValue;
+        total = 100;
+    } else {
+        ERROR("Invalid variable link in processLoadingCircle");
+        return false;
+    }
+
+    LoadingCircle* circle = findLoadingCircle(dev, centerX, centerY);
+    uint16_t sweep = (total == 0 || value >= total) ? 360 : (uint16_t)(((uint64_t)360 * value) / total);
+
+    if (!updateLoadingCircle(dev, circle, 0, sweep)) {
+        return false;
+    }
+
+    for (uint8_t a = 0; a < circle->changedAreaCount; ++a)
+    {
+        const ScreenArea* area = &circle->changedAreas[a];
+
+        if (!sendBufferArea(dev, area->x1, area->y1, area->x2, area->y2)) {
+            ERROR("Could not send buffer to screen");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool barAdjuster(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable)
+{
+    uint8_t numberOfBars;
+    uint8_t activeBars;
+    uint8_t barWidth;
+    uint8_t barHeight;
+    uint8_t barSpacing;
+    uint8_t topY;
+    uint8_t leftX;
+
+    if (variable == getCalibrationValue(BUTTONS)) {
+        numberOfBars = 8;
+        activeBars = getCalibrationValue(BUTTONS) + 1;
+        barWidth = 100;
+        barHeight = 8;
+        barSpacing = 12;
+    } else {
+        ERROR("Invalid or unimplemented variable in barAdjuster");
+        return false;
+    }
+
+    leftX = centerX - (barWidth / 2);
+    topY = centerY - (((numberOfBars * barHeight) + (barSpacing * (numberOfBars - 1))) / 2);
+
+    for (uint8_t b = 0; b < numberOfBars; ++b)
+    {
+        if (numberOfBars - b <= activeBars) {
+            fillBufferAreaWithColour(dev, leftX, topY + (b * (barHeight + barSpacing)), leftX + barWidth, topY + (b * (barHeight + barSpacing)) + barHeight, SCREEN_COLOUR(WHITE));
+        } else {
+            fillBufferAreaWithColour(dev, leftX, topY + (b * (barHeight + barSpacing)), leftX + barWidth, topY + (b * (barHeight + barSpacing)) + barHeight, SCREEN_COLOUR(BLACK));
+        }
+    }
+
+    // DEBUG("Variables:\n\t* leftX: %i\n\t* topY: %i\n\t* bottomY: %i\n\t* bottomY: %i", leftX, topY, leftX + barWidth, topY + ((numberOfBars * barHeight) + (barSpacing * (numberOfBars - 1))));
+
+    return sendBufferArea(dev, leftX, topY, leftX + barWidth, topY + ((numberOfBars * barHeight) + (barSpacing * (numberOfBars - 1))));
+}
+
+
+// ----------------------------------------------
+//                    OLD CODE
+// ----------------------------------------------
+
+/*bool sendBytes(TFT_t* dev, DataOrCommand doc, uint8_t* buffer, uint16_t size)
+{
+    // DC pin should by default in DATA mode, and changed to COMMAND only while sending, and then reset!
+
+    if (doc == COMMAND) { 
+        gpio_set_level(dev->_dc, COMMAND)
+        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
+            gpio_set_level(dev->_dc, DATA)
+            return true;
+        } else {
+            ERROR("Could not write 8 bit data to ILI9341 screen!");
+            gpio_set_level(dev->_dc, DATA);
+            return false;
+        }
+    } else {
+        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
+            return true;
+        } else {
+            ERROR("Could not write 8 bit data to ILI9341 screen!");
+            return false
+        }
+    }
+}*/
+
+
+/*bool send16bits(TFT_t* dev, DataOrCommand doc, uint16_t* buffer, uint16_t size)
+{
+    // DC pin should by default in DATA mode, and changed to COMMAND only while sending, and then reset!
+
+    if (doc == COMMAND) { 
+        gpio_set_level(dev->_dc, COMMAND)
+            // UNREVERSED BUFFER !!!
+        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
+            gpio_set_level(dev->_dc, DATA)
+            return true;
+        } else {
+            ERROR("Could not write 8 bit data to ILI9341 screen!");
+            gpio_set_level(dev->_dc, DATA);
+            return false;
+        }
+    } else {
+            // UNREVERSED BUFFER !!!
+        if (spi_master_write_byte( dev->_SPIHandle, buffer, size)) {
+            return true;
+        } else {
+            ERROR("Could not write 8 bit data to ILI9341 screen!");
+            return false
+        }
+    }
 }*/
\ No newline at end of file
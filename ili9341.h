@@ -1,124 +1,623 @@
-#ifndef __ILI9341_H__
-#define __ILI9341_H__
-
-#define SCREEN_WIDTH 	240
-#define SCREEN_HEIGHT	320
-#define SCREEN_PIXELS_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT)
-#define SCREEN_BYTES_SIZE (SCREEN_PIXELS_SIZE * 2)
-
-// 75 * 2^10 = 76.800 :)
-#define SCREEN_BYTES_MEMCPY_NUMBER 75
-#define SCREEN_BYTES_MEMCPY_EXPONENT 10
-
-// // We can send 8 rows at the time (Max SPI transaction size 4094 Bytes)
-#define SCREEN_MAX_TRANSMISSION_BUFFER (SCREEN_WIDTH * (SCREEN_HEIGHT / 40) * 2)
-#define MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND 40
-
-typedef enum DataOrCommand {
-	COMMAND = 0,
-	DATA 	= 1
-} DataOrCommand;
-
-struct FontxFile;
-struct Image;
-
-bool setupScreen();
-
-bool fillEntireBufferWithColour(uint16_t colour);
-bool fillEntireBufferWithImage(struct Image* image);
-
-bool fillBufferAreaWithColour(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour);
-bool fillBufferAreaWithImage(uint16_t x1, uint16_t y1, struct Image* image);
-
-bool frameArea(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t frameThickness, uint16_t frameColour, uint16_t areaColour);
-
-bool writeText(char* text, uint8_t spacing, bool normalizedWidth, struct FontxFile* fx, uint16_t x, uint16_t y, uint16_t textColour);
-
-// Graphic functions
-bool loadingBar(uint16_t centerX, uint16_t centerY, intptr_t variable);
-bool brewingAnimation(uint16_t centerX, uint16_t centerY, uint8_t stage);
-bool processLoadingCircle(uint16_t centerX, uint16_t centerY, intptr_t variable);
-bool barAdjuster(uint16_t centerX, uint16_t centerY, intptr_t variable);
-
-bool sendEntireBuffer();
-bool sendBufferArea(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
-
-#define ILI9341_NOP                                         0x00
-#define ILI9341_RESET                                       0x01
-#define ILI9341_READ_DISPLAY_IDENTIFICATION_INFORMATION		0x04
-#define ILI9341_READ_DISPLAY_STATUS                         0x09
-#define ILI9341_READ_DISPLAY_POWER_MODE                     0x0A
-#define ILI9341_READ_DISPLAY_MADCTL                         0x0B
-#define ILI9341_READ_DISPLAY_PIXEL_FORMAT                   0x0C
-#define ILI9341_READ_DISPLAY_IMAGE_FORMAT                   0x0D
-#define ILI9341_READ_DISPLAY_SIGNAL_MODE                    0x0E
-#define ILI9341_READ_DISPLAY_SELF_DIAGNOSTIC_RESULT         0x0F
-#define ILI9341_ENTER_SLEEP_MODE                            0x10
-#define ILI9341_SLEEP_OUT                                   0x11
-#define ILI9341_PARTIAL_MODE_ON                             0x12
-#define ILI9341_NORMAL_DISPLAY_MODE_ON                      0x13
-#define ILI9341_DISPLAY_INVERSION_OFF                       0x20
-#define ILI9341_DISPLAY_INVERSION_ON                        0x21
-#define ILI9341_SET_GAMMA                                   0x26
-#define ILI9341_DISPLAY_OFF                                 0x28
-#define ILI9341_DISPLAY_ON                                  0x29
-#define ILI9341_COLUMN_ADDR                                 0x2A
-#define ILI9341_PAGE_ADDR                                   0x2B
-#define ILI9341_WRITE_RAM                                   0x2C
-#define ILI9341_COLOR_SET                                   0x2D
-#define ILI9341_MEMORY_READ                                 0x2E
-#define ILI9341_PARTIAL_AREA                                0x30
-#define ILI9341_VERTICAL_SCROLLING_DEFINITION               0x33
-#define ILI9341_TEARING_EFFECT_LINE_OFF                     0x34
-#define ILI9341_TEARING_EFFECT_LINE_ON                      0x35
-#define ILI9341_MEMORY_ACCESS_CONTROL                       0x36
-#define ILI9341_VERTICAL_SCROLLING_START_ADDRESS            0x37
-#define ILI9341_IDLE_MODE_OFF                               0x38
-#define ILI9341_IDLE_MODE_ON                                0x39
-#define ILI9341_PIXEL_FORMAT                                0x3A
-#define ILI9341_WMC                                         0x3C
-#define ILI9341_RMC                                         0x3E
-#define ILI9341_SET_TEAR_SCANLINE                           0x44
-#define ILI9341_WDB                                         0x51
-#define ILI9341_READ_DISPLAY_BRIGHTNESS                     0x52
-#define ILI9341_WCD                                         0x53
-#define ILI9341_READ_CTRL_DISPLAY                           0x54
-#define ILI9341_WCABC                                       0x55
-#define ILI9341_RCABC                                       0x56
-#define ILI9341_WCABCMB                                     0x5E
-#define ILI9341_RCABCMB                                     0x5F
-#define ILI9341_RGB_INTERFACE                               0xB0
-#define ILI9341_FRAME_RATE_CONTROL							0xB1
-#define ILI9341_FRAME_CTRL_NM                               0xB2
-#define ILI9341_FRAME_CTRL_IM                               0xB3
-#define ILI9341_FRAME_CTRL_PM                               0xB4
-#define ILI9341_BPC                                         0xB5
-#define ILI9341_DISPLAY_FUNCTION_CONTROL                    0xB6
-#define ILI9341_ENTRY_MODE_SET                              0xB7
-#define ILI9341_BACKLIGHT_CONTROL_1                         0xB8
-#define ILI9341_BACKLIGHT_CONTROL_2                         0xB9
-#define ILI9341_BACKLIGHT_CONTROL_3                         0xBA
-#define ILI9341_BACKLIGHT_CONTROL_4                         0xBB
-#define ILI9341_BACKLIGHT_CONTROL_5                         0xBC
-#define ILI9341_BACKLIGHT_CONTROL_6                         0xBD
-#define ILI9341_BACKLIGHT_CONTROL_7                         0xBE
-#define ILI9341_BACKLIGHT_CONTROL_8                         0xBF
-#define ILI9341_POWER1                                      0xC0
-#define ILI9341_POWER2                                      0xC1
-#define ILI9341_VCOM1                                       0xC5
-#define ILI9341_VCOM2                                       0xC7
-#define ILI9341_POWERA                                      0xCB
-#define ILI9341_POWERB                                      0xCF
-#define ILI9341_READ_ID1                                    0xDA
-#define ILI9341_READ_ID2                                    0xDB
-#define ILI9341_READ_ID3                                    0xDC
-#define ILI9341_POSITIVE_GAMMA_CORRECTION                   0xE0
-#define ILI9341_NEGATIVE_GAMMA_CORRECTION                   0xE1
-#define ILI9341_DTCA                                        0xE8
-#define ILI9341_DTCB                                        0xEA
-#define ILI9341_POWER_SEQ                                   0xED
-#define ILI9341_3GAMMA_EN                                   0xF2
-#define ILI9341_INTERFACE                                   0xF6
-#define ILI9341_PRC                                         0xF7
-
+#ifndef __ILI9341_H__
+#define __ILI9341_H__
+
+#include <driver/spi_master.h>
+#include <ili9341_image.h>
+
+#define SCREEN_WIDTH 	240
+#define SCREEN_HEIGHT	320
+#define SCREEN_PIXELS_SIZE (SCREEN_WIDTH * SCREEN_HEIGHT)
+#define SCREEN_BYTES_SIZE (SCREEN_PIXELS_SIZE * 2)
+
+// // We can send 8 rows at the time (Max SPI transaction size 4094 Bytes)
+#define SCREEN_MAX_TRANSMISSION_BUFFER (SCREEN_WIDTH * (SCREEN_HEIGHT / 40) * 2)
+#define MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND 40
+
+// Enough queue slots for a whole frame, so every strip can be handed to the SPI driver at once
+#define SCREEN_SPI_QUEUE_SIZE MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND
+
+// Screens sharing an SPI bus split the queue slots between the ones sending, and one that gets this many bytes ahead
+// of another lets its queue run dry so the other is served
+#define SCREEN_BUS_MAX_SCREENS 4
+#define SCREEN_BUS_QUANTUM (SCREEN_MAX_TRANSMISSION_BUFFER * 2)
+
+// DMA-capable staging for partial areas, each within the 4094 byte transaction limit
+#define SCREEN_STAGING_BUFFER_COUNT 2
+#define SCREEN_STAGING_BUFFER_SIZE SCREEN_MAX_TRANSMISSION_BUFFER
+
+// Dirty area tracking. A new address window costs 6 transactions, which is roughly the time it takes to send this many pixels
+#define SCREEN_MAX_DIRTY_AREAS 8
+#define SCREEN_WINDOW_OVERHEAD_PIXELS 256
+
+// Anti-aliased text is blended against the buffer in this many coverage levels
+#define TEXT_BLEND_SHIFT 5
+#define TEXT_BLEND_LEVELS (1 << TEXT_BLEND_SHIFT)
+
+// Pre-rasterised glyphs per font and colour, evicted least recently used first. Glyphs too large for a slot are drawn uncached.
+#define GLYPH_CACHE_SLOTS 16
+#define GLYPH_CACHE_SLOT_SIZE 1024
+
+#define TEXT_LABEL_MAX_LENGTH 16
+#define SCREEN_LOADING_BARS 4
+#define SCREEN_LOADING_CIRCLES 4
+
+// Colours passed to the drawing functions, palettes and struct Image pixel data are already in wire order, so nothing
+// is byte swapped at run time. Write colours as SCREEN_COLOUR(RED) to build for either order, and generate images
+// with image_compressor --raw.
+// #define SCREEN_WIRE_ORDER
+
+#ifdef SCREEN_WIRE_ORDER
+#define SCREEN_COLOUR(colour) WIRE_ORDER(colour)
+#else
+#define SCREEN_COLOUR(colour) (colour)
+#endif
+
+// Strip renderer: drops the full screen buffer and instead records draw calls into a display list, which is replayed into
+// two small strip buffers as areas are sent. Saves about 130 KB of RAM at the cost of rasterising on every send.
+// #define SCREEN_STRIP_RENDERER
+#define SCREEN_STRIP_HEIGHT 16
+#define SCREEN_STRIP_PIXELS (SCREEN_WIDTH * SCREEN_STRIP_HEIGHT)
+
+// Recorded draw calls, each clipped into at most this many visible pieces around the opaque ones drawn over it
+#define SCREEN_DISPLAY_LIST_SIZE 128
+#define SCREEN_DISPLAY_LIST_MAX_PIECES 16
+
+// Indexed framebuffer: one byte per pixel into a palette of up to 256 RGB565 colours, expanded a strip at a time as it is
+// sent. Halves the screen buffer to 76.8 KB. Colours drawn are mapped to the nearest palette entry. Not combinable with
+// SCREEN_STRIP_RENDERER.
+// #define SCREEN_INDEXED_FRAMEBUFFER
+#define SCREEN_INDEXED_STRIP_PIXELS (SCREEN_MAX_TRANSMISSION_BUFFER / 2)
+
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+#define SCREEN_STRIP_BUFFER_PIXELS SCREEN_INDEXED_STRIP_PIXELS
+#else
+#define SCREEN_STRIP_BUFFER_PIXELS SCREEN_STRIP_PIXELS
+#endif
+
+#define SCREEN_SPI_CLOCK_HZ 60000000
+
+// Immediate mode fills stream from a buffer of this many bytes of one colour. The default covers the screen in as
+// many transactions as the SPI queue holds, so a clear is queued in one go.
+#define SCREEN_PATTERN_BUFFER_SIZE SCREEN_MAX_TRANSMISSION_BUFFER
+
+// Panel refresh rate set by setupScreen. The panel makes 119 Hz and steps down from there, see setFrameRate.
+#define SCREEN_FRAME_RATE 79
+
+// Frame pacing: sends wait for the point in the panel refresh where the scan cannot cross the write pointer anywhere
+// in the area, so an update is never shown half old and half new. The scan position comes from the panel's TE output
+// when the screen's config has a tePin, SCREEN_TE_PIN from pinmap.h for the default screen. Without it the driver can
+// only assume a scan that started with setFrameRate, which drifts with the panel's oscillator.
+// #define SCREEN_FRAME_PACING
+#define SCREEN_PACING_MARGIN_LINES 4
+
+// Performance counters: bytes, transactions and address window setups, CPU cycles spent rasterising and waiting on SPI
+// for each kind of call, and a histogram of frame times. Each rasterisation and wait reads the cycle counter twice.
+// #define SCREEN_PERF_COUNTERS
+#define SCREEN_PERF_HISTOGRAM_BUCKETS 16
+#define SCREEN_PERF_BUCKET_US 4000     // The last bucket takes everything slower
+
+// SPI trace: every transaction handed to the SPI driver is recorded by ili9341_trace.c, see ili9341_trace.h
+// #define SCREEN_SPI_TRACE
+
+typedef enum DataOrCommand {
+	COMMAND = 0,
+	DATA 	= 1
+} DataOrCommand;
+
+// Inclusive screen area, same convention as setScreenWriteArea
+typedef struct ScreenArea {
+	uint16_t x1;
+	uint16_t y1;
+	uint16_t x2;
+	uint16_t y2;
+} ScreenArea;
+
+struct FontxFile;
+struct Image;
+
+typedef struct GlyphCacheStats {
+	uint32_t hits;
+	uint32_t misses;
+	uint32_t evictions;
+	uint32_t uncacheable;
+	uint8_t slotsUsed;
+} GlyphCacheStats;
+
+// pixelsSubmitted / pixelsWritten is the overdraw that drawing every call straight into the buffer would have cost.
+// The strip renderer rasterises again on every send, so there pixelsWritten also counts areas sent more than once.
+typedef struct RenderStats {
+	uint32_t recorded;			// Draw calls
+	uint32_t dropped;			// Draw calls removed before rasterisation, as later opaque ones covered them
+	uint32_t culled;			// Rasterisations skipped as fully covered
+	uint32_t clipped;			// Rasterisations split around opaque commands drawn over them
+	uint32_t pixelsSubmitted;
+	uint32_t pixelsWritten;
+} RenderStats;
+
+typedef struct FramePacingStats {
+	uint32_t vsyncs;			// TE pulses seen
+	uint32_t sends;				// Paced sends
+	uint32_t waits;				// Sends held back for the scan
+	uint32_t deadlineMisses;	// Sends the scan caught up with, or too slow to ever fit between two refreshes
+	uint32_t maxWaitUs;
+	uint64_t totalWaitUs;
+	uint32_t framePeriodUs;		// Refined from TE when it is wired
+	uint32_t pixelWriteTimeNs;	// Current estimate, learned from sends that wait for their transmission
+} FramePacingStats;
+
+// Calls timed on their own. A call made from inside another one counts towards the outer call.
+typedef enum ScreenPerfCall {
+	SCREEN_PERF_OTHER = 0,				// Rasterising and waits outside the calls below, like setScreenWriteArea
+	SCREEN_PERF_SEND_ENTIRE_BUFFER,		// sendEntireBuffer and sendEntireBufferAsync
+	SCREEN_PERF_SEND_BUFFER_AREA,
+	SCREEN_PERF_FLUSH_DIRTY,
+	SCREEN_PERF_FILL_SCREEN_AREA,		// Immediate mode fills
+	SCREEN_PERF_CALL_COUNT
+} ScreenPerfCall;
+
+typedef struct ScreenPerfCallStats {
+	uint32_t calls;
+	uint64_t totalCycles;
+	uint64_t rasteriseCycles;			// Replaying the display list and getting pixels ready for the wire
+	uint64_t spiWaitCycles;				// Blocked on transactions to finish
+} ScreenPerfCallStats;
+
+typedef struct ScreenPerfCounters {
+	uint64_t bytes;
+	uint32_t transactions;
+	uint32_t windowSetups;				// setScreenWriteArea calls
+	uint32_t addressCommands;			// Column and page address commands sent, as the unchanged ones are skipped
+	uint32_t stagingStalls;				// sendBufferArea waiting for a staging buffer to come back from DMA
+	ScreenPerfCallStats calls[SCREEN_PERF_CALL_COUNT];
+	uint32_t frameTimes[SCREEN_PERF_HISTOGRAM_BUCKETS];	// sendEntireBuffer and flushDirty calls, SCREEN_PERF_BUCKET_US per bucket
+	uint32_t cyclesPerUs;
+} ScreenPerfCounters;
+
+// Text that remembers how it was last drawn, so an update only redraws the chars that changed
+typedef struct TextLabel {
+	struct FontxFile* fx;
+	uint16_t x;							// Centre
+	uint16_t y;							// Top
+	uint8_t spacing;
+	bool normalizedWidth;
+	uint16_t textColour;
+	uint16_t backgroundColour;
+
+	// Last drawn state
+	bool drawn;
+	char text[TEXT_LABEL_MAX_LENGTH + 1];
+	uint8_t length;
+	uint16_t startX;
+	uint16_t width;
+	uint16_t cellX[TEXT_LABEL_MAX_LENGTH];
+	uint16_t cellWidth[TEXT_LABEL_MAX_LENGTH];
+
+	// Areas touched by the last update, already marked dirty
+	ScreenArea changedAreas[TEXT_LABEL_MAX_LENGTH];
+	uint8_t changedAreaCount;
+} TextLabel;
+
+// Progress bar that remembers how far it was last drawn, so an update only redraws the columns that changed. The bar
+// has slanted ends, edged with edgeColour, and sits centred on its background.
+typedef struct ProgressBar {
+	const struct Image* background;		// NULL for a plain area of backgroundColour the size of the bar
+	uint16_t backgroundColour;
+	uint16_t colour;
+	uint16_t edgeColour;
+	uint16_t x;							// Top left of the background
+	uint16_t y;
+	uint16_t width;
+	uint16_t height;
+	uint16_t barX;						// Top left of the bar
+	uint16_t barY;
+	uint16_t length;
+	uint8_t thickness;
+
+	// Last drawn state
+	bool drawn;
+	uint16_t pixelProgress;
+
+	// Area touched by the last update, already marked dirty. Empty, with x1 > x2, when nothing changed.
+	ScreenArea changedArea;
+} ProgressBar;
+
+// Ring that remembers which part of it was last highlighted, so an update only redraws the sectors that changed. Angles
+// are in degrees, clockwise from 12 o'clock.
+#define LOADING_CIRCLE_MAX_CHANGED_AREAS 8
+
+typedef struct LoadingCircle {
+	uint16_t centerX;
+	uint16_t centerY;
+	uint8_t outerRadius;
+	uint8_t innerRadius;
+	uint16_t colour;					// Highlighted part
+	uint16_t trackColour;				// The rest of the ring
+	uint16_t backgroundColour;			// Under the ring, which its edges blend with
+
+	// Last drawn state
+	bool drawn;
+	uint16_t startAngle;
+	uint16_t sweep;
+
+	// Boxes around the sectors changed by the last update, already marked dirty. Sectors are split at the quarter
+	// turns, so each box stays tight.
+	ScreenArea changedAreas[LOADING_CIRCLE_MAX_CHANGED_AREAS];
+	uint8_t changedAreaCount;
+} LoadingCircle;
+
+// Recorded draw call, see the display list in ili9341.c
+typedef struct DrawCommand {
+	ScreenArea area;
+	uint8_t type;
+	union {
+		char ascii;
+		uint8_t arcFlags;
+	};
+	uint16_t colour;					// Wire order for fills and arcs, native for glyphs
+	union {
+		struct {
+			uint16_t glyphXPos;
+			uint16_t glyphWidth;
+		};
+		struct {
+			uint16_t imageX;				// Where the whole image sits when only part of it is drawn
+			uint16_t imageY;
+		};
+		struct {
+			uint16_t startAngle;			// Arcs fill area, the box around their whole circle
+			uint16_t sweep;
+		};
+	};
+	union {
+		const struct Image* image;
+		const CompressedImage* compressedImage;
+		const IndexedImage* indexedImage;
+		struct FontxFile* fx;
+		struct {
+			uint8_t outerRadius;
+			uint8_t innerRadius;
+			uint16_t arcBackground;			// Wire order, what the edges blend with when drawn over a known colour
+		};
+	};
+} DrawCommand;
+
+// Pre-rasterised glyph in a glyph cache slot
+typedef struct GlyphCacheEntry {
+	const struct FontxFile* fx;
+	uint16_t colour;
+	char ascii;
+	uint16_t spanCount;
+	uint32_t lastUsed;					// 0 for a free slot
+} GlyphCacheEntry;
+
+// Widest pixel offset from the centre column in each row out from the centre row, of the pixels within a squared
+// distance of bound from the centre pixel
+typedef struct ArcSpanTable {
+	uint8_t rows;						// Last row inside
+	uint8_t halfWidth[256];
+} ArcSpanTable;
+
+// Span tables of the last ring a screen drew
+typedef struct ArcRingSpans {
+	uint8_t outerRadius;
+	uint8_t innerRadius;
+	bool valid;
+	ArcSpanTable solid;					// Fully inside the outer edge
+	ArcSpanTable reach;					// Touched by the outer edge
+	ArcSpanTable holeEdge;				// Touched by the inner edge
+	ArcSpanTable hole;					// Fully inside the inner edge
+} ArcRingSpans;
+
+// Bars loadingBar has drawn on a screen, found again by centre
+typedef struct LoadingBar {
+	bool used;
+	uint16_t centerX;
+	uint16_t centerY;
+	uint32_t bufferClears;
+	ProgressBar bar;
+} LoadingBar;
+
+// Circles processLoadingCircle has drawn on a screen, found again by centre
+typedef struct ProcessLoadingCircle {
+	bool used;
+	uint16_t centerX;
+	uint16_t centerY;
+	uint32_t bufferClears;
+	LoadingCircle circle;
+} ProcessLoadingCircle;
+
+struct TFT_t;
+
+// An SPI host shared by one or more screens. The bus itself is initialised by the application with spi_bus_initialize.
+typedef struct ScreenBus {
+	spi_host_device_t host;
+	struct TFT_t* screens[SCREEN_BUS_MAX_SCREENS];
+	uint8_t screenCount;
+} ScreenBus;
+
+// Pins are -1 when not wired. width and height may be less than the panel, to use only its top left corner.
+typedef struct ScreenConfig {
+	uint16_t width;
+	uint16_t height;
+	int16_t csPin;
+	int16_t dcPin;
+	int16_t resetPin;
+	int16_t tePin;						// Only used with SCREEN_FRAME_PACING
+	int16_t backlightPin;
+	int clockSpeedHz;
+	ScreenBus* bus;
+	void* buffer;						// width * height pixels, one byte each in indexed mode, NULL in strip renderer mode
+} ScreenConfig;
+
+// One panel: its pins, SPI device, buffers and drawing state, including the caches and scratch tables drawing uses, so
+// screens drawn from different tasks share nothing that changes. Transactions and strip buffers are read by DMA, so a
+// screen must live in internal RAM, declared static or global.
+typedef struct TFT_t {
+	uint16_t _model;
+	uint16_t _width;
+	uint16_t _height;
+	uint16_t _offsetx;
+	uint16_t _offsety;
+	uint16_t _font_direction;
+	uint16_t _font_fill;
+	uint16_t _font_fill_color;
+	uint16_t _font_underline;
+	uint16_t _font_underline_color;
+	int16_t _cs;
+	int16_t _dc;
+	int16_t _reset;
+	int16_t _te;
+	int16_t _bl;
+	spi_device_handle_t _SPIHandle;
+	ScreenBus* _bus;
+	uint32_t _busBytes;					// Bytes queued, on a clock shared with the other screens on the bus
+	bool _busActive;
+#if defined(SCREEN_INDEXED_FRAMEBUFFER)
+	uint8_t* _buffer;					// Palette indices
+#elif !defined(SCREEN_STRIP_RENDERER)
+	uint16_t* _buffer;
+#endif
+	ScreenArea _dirtyAreas[SCREEN_MAX_DIRTY_AREAS];
+	uint8_t _dirtyAreaCount;
+	uint8_t _transactionsInFlight;
+	ScreenArea _window;
+	bool _windowValid;
+	volatile bool _transmissionDone;
+	void (*_onTransmissionDone)(void* arg);
+	void* _onTransmissionDoneArg;
+	uint16_t _topFixedArea;
+	uint16_t _scrollArea;				// Rows in the scroll area, 0 when scrolling is not set up
+	uint16_t _scrollStart;
+	uint32_t _framePeriodNs;
+	uint32_t _lineTimeNs;
+#ifdef SCREEN_FRAME_PACING
+	volatile int64_t _lastVsyncUs;
+	uint32_t _pixelWriteTime;			// ns * 16
+	int64_t _pacedStartUs;
+	int64_t _pacedDeadlineUs;			// INT64_MAX when the send cannot be checked
+	uint32_t _pacedPixels;				// 0 when no send is in progress
+	FramePacingStats _pacingStats;
+#endif
+	uint32_t _bufferClears;				// Entire buffer fills, which leave nothing of the widgets drawn before
+	DrawCommand _displayList[SCREEN_DISPLAY_LIST_SIZE];
+	uint16_t _displayListLength;
+	RenderStats _renderStats;
+#ifdef SCREEN_PERF_COUNTERS
+	ScreenPerfCounters _perf;
+	uint8_t _perfCall;					// ScreenPerfCall being timed, SCREEN_PERF_OTHER between calls
+	uint32_t _perfCallStart;
+#endif
+	spi_transaction_t _stripTransactions[MAX_TRANSMISSION_BUFFER_TIMES_TO_SEND];
+#if defined(SCREEN_STRIP_RENDERER) || defined(SCREEN_INDEXED_FRAMEBUFFER)
+	uint16_t _stripBuffers[2][SCREEN_STRIP_BUFFER_PIXELS] __attribute__((aligned(4)));	// One rendered while the other is on the wire
+#else
+	uint8_t _stagingBuffers[SCREEN_STAGING_BUFFER_COUNT][SCREEN_STAGING_BUFFER_SIZE] __attribute__((aligned(4)));	// Areas narrower than the screen, which are not contiguous in _buffer
+	spi_transaction_t _stagingTransactions[SCREEN_STAGING_BUFFER_COUNT];
+#endif
+	uint16_t _patternBuffer[SCREEN_PATTERN_BUFFER_SIZE / 2] __attribute__((aligned(4)));
+	uint16_t _patternColour;
+	bool _patternValid;
+	GlyphCacheEntry _glyphCacheEntries[GLYPH_CACHE_SLOTS];
+	uint32_t _glyphCacheArena[GLYPH_CACHE_SLOTS][GLYPH_CACHE_SLOT_SIZE / sizeof(uint32_t)];
+	uint32_t _glyphCacheClock;
+	GlyphCacheStats _glyphCacheStats;
+	uint32_t _textShades[TEXT_BLEND_LEVELS + 1];	// Text colour scaled by every coverage level
+	uint16_t _textShadesColour;
+	bool _textShadesValid;
+	ArcRingSpans _arcRing;
+	LoadingBar _loadingBars[SCREEN_LOADING_BARS];
+	uint8_t _nextLoadingBar;
+	ProcessLoadingCircle _loadingCircles[SCREEN_LOADING_CIRCLES];
+	uint8_t _nextLoadingCircle;
+} TFT_t;
+
+// Init tables are sequences of: command, argument count (| SCREEN_INIT_DELAY), arguments, [delay in ms]
+#define SCREEN_INIT_DELAY 0x80
+#define SCREEN_INIT_END   0xFF
+
+extern const uint8_t ili9341DefaultInitTable[];
+
+// Adds the screen to config->bus and brings the panel up. A NULL config means the one screen wired as in pinmap.h, on
+// HSPI_HOST, drawing into the driver's own buffer.
+bool setupScreen(TFT_t* dev, const ScreenConfig* config);
+
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+// Colours are RGB565, in wire order with SCREEN_WIRE_ORDER. All screens share the palette. setupScreen installs the
+// default 3-3-2 RGB palette unless one is set first.
+bool setScreenPalette(const uint16_t* palette, uint16_t count);
+bool setDefaultScreenPalette();
+#endif
+// Brings the panel up with initTable in place of the default one. The panel is then set to SCREEN_FRAME_RATE, unless
+// the table sends its own FRAME_RATE_CONTROL (0xB1), which is kept.
+bool setupScreenWithTable(TFT_t* dev, const ScreenConfig* config, const uint8_t* initTable);
+bool sendCommandTable(TFT_t* dev, const uint8_t* table);
+
+// Sets the closest refresh rate the panel can make, from 119 Hz down to about 7.6 Hz
+bool setFrameRate(TFT_t* dev, uint8_t framesPerSecond);
+
+#ifdef SCREEN_FRAME_PACING
+// Deadline misses are only checked for sends that wait for their transmission, not for sendEntireBufferAsync
+void getFramePacingStats(TFT_t* dev, FramePacingStats* stats);
+void resetFramePacingStats(TFT_t* dev);
+#endif
+
+// Draw calls are recorded, not copied: the Image, CompressedImage, IndexedImage and FontxFile passed in, with the
+// pixel and glyph data they point to, are read when the area is sent. They must stay valid until the next send or
+// flush, and with SCREEN_STRIP_RENDERER for as long as they are on screen, until drawn over or a whole buffer fill.
+bool fillEntireBufferWithColour(TFT_t* dev, uint16_t colour);
+bool fillEntireBufferWithImage(TFT_t* dev, struct Image* image);
+bool fillEntireBufferWithCompressedImage(TFT_t* dev, const CompressedImage* image);
+
+bool fillBufferAreaWithColour(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour);
+bool fillBufferAreaWithImage(TFT_t* dev, uint16_t x1, uint16_t y1, struct Image* image);
+bool fillBufferAreaWithCompressedImage(TFT_t* dev, uint16_t x1, uint16_t y1, const CompressedImage* image);
+bool fillBufferAreaWithIndexedImage(TFT_t* dev, uint16_t x1, uint16_t y1, const IndexedImage* image);
+
+// Immediate mode: fills the area on the panel directly, with x2 and y2 exclusive like fillBufferAreaWithColour. Returns
+// once the transfer is queued, so the CPU is free while it goes out. Without updateBuffer the buffer is left as it
+// was, and sending that area again brings back the old content.
+bool fillScreenAreaWithColour(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour, bool updateBuffer);
+bool fillEntireScreenWithColour(TFT_t* dev, uint16_t colour, bool updateBuffer);
+
+bool frameArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint8_t frameThickness, uint16_t frameColour, uint16_t areaColour);
+
+// The text is looked up straight away, but the glyphs are read from fx when sent, see above
+bool writeText(TFT_t* dev, char* text, uint8_t spacing, bool normalizedWidth, struct FontxFile* fx, uint16_t x, uint16_t y, uint16_t textColour);
+
+void initTextLabel(TextLabel* label, struct FontxFile* fx, uint16_t x, uint16_t y, uint8_t spacing, bool normalizedWidth, uint16_t textColour, uint16_t backgroundColour);
+bool updateTextLabel(TFT_t* dev, TextLabel* label, const char* text);
+
+// Anti-aliased ring sector blended over what is under it. Angles are in degrees, clockwise from 12 o'clock, with
+// startAngle < endAngle <= startAngle + 360. An innerRadius of 0 fills a pie slice.
+bool fillBufferArc(TFT_t* dev, uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t startAngle, uint16_t endAngle, uint16_t colour);
+
+void initProgressBar(ProgressBar* bar, uint16_t centerX, uint16_t centerY, uint16_t length, uint8_t thickness, const struct Image* background, uint16_t backgroundColour, uint16_t colour, uint16_t edgeColour);
+// Shows value out of total. Anything else drawn over the bar needs initProgressBar again, to draw it in full.
+bool updateProgressBar(TFT_t* dev, ProgressBar* bar, uint32_t value, uint32_t total);
+
+void initLoadingCircle(LoadingCircle* circle, uint16_t centerX, uint16_t centerY, uint8_t outerRadius, uint8_t innerRadius, uint16_t colour, uint16_t trackColour, uint16_t backgroundColour);
+// Highlights sweep degrees from startAngle, 0 for none. Anything else drawn over the ring needs initLoadingCircle again.
+bool updateLoadingCircle(TFT_t* dev, LoadingCircle* circle, uint16_t startAngle, uint16_t sweep);
+
+// Each screen has its own glyph cache
+void getGlyphCacheStats(TFT_t* dev, GlyphCacheStats* stats);
+void resetGlyphCache(TFT_t* dev);
+
+void getRenderStats(TFT_t* dev, RenderStats* stats);
+void resetRenderStats(TFT_t* dev);
+
+#ifdef SCREEN_PERF_COUNTERS
+// A copy of the counters, which may be a count apart from each other when the screen is drawing on another task
+void getScreenPerfCounters(TFT_t* dev, ScreenPerfCounters* counters);
+void resetScreenPerfCounters(TFT_t* dev);
+#endif
+
+// Graphic functions. loadingBar and processLoadingCircle keep a ProgressBar or LoadingCircle for each of the last
+// SCREEN_LOADING_BARS or SCREEN_LOADING_CIRCLES places they drew at on the screen, and send only what changed. Filling
+// the entire buffer makes them draw in full again.
+bool loadingBar(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable);
+bool brewingAnimation(TFT_t* dev, uint16_t centerX, uint16_t centerY, uint8_t stage);
+bool processLoadingCircle(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable);
+bool barAdjuster(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable);
+
+bool sendEntireBuffer(TFT_t* dev);
+// Returns as soon as every strip is queued. onDone runs from the SPI interrupt once the last strip is out.
+// The screen buffer must not be drawn into before the transmission is done.
+bool sendEntireBufferAsync(TFT_t* dev, void (*onDone)(void* arg), void* arg);
+bool isTransmissionDone(TFT_t* dev);
+bool waitForTransmission(TFT_t* dev);
+bool sendBufferArea(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+
+// The last address window is cached. Anything sending CASET/PASET/MADCTL outside the driver must invalidate it.
+void invalidateScreenWriteArea(TFT_t* dev);
+
+// Dirty area tracking - every draw call marks what it touched, flushDirty sends only the merged areas
+void markBufferAreaDirty(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+bool flushDirty(TFT_t* dev);
+
+// Hardware vertical scrolling between fixed top and bottom areas. Drawing coordinates are buffer rows, which scroll with
+// the content. scrollScreen(n) moves the content up n rows with one short command; the last n rows of the area then
+// show what scrolled off the top, so draw the new content at getScrolledRow(row) for those screen rows and flush.
+bool setScrollArea(TFT_t* dev, uint16_t topFixedArea, uint16_t bottomFixedArea);
+bool scrollScreen(TFT_t* dev, int16_t lines);
+uint16_t getScrolledRow(TFT_t* dev, uint16_t screenRow);
+
+#define ILI9341_NOP                                         0x00
+#define ILI9341_RESET                                       0x01
+#define ILI9341_READ_DISPLAY_IDENTIFICATION_INFORMATION		0x04
+#define ILI9341_READ_DISPLAY_STATUS                         0x09
+#define ILI9341_READ_DISPLAY_POWER_MODE                     0x0A
+#define ILI9341_READ_DISPLAY_MADCTL                         0x0B
+#define ILI9341_READ_DISPLAY_PIXEL_FORMAT                   0x0C
+#define ILI9341_READ_DISPLAY_IMAGE_FORMAT                   0x0D
+#define ILI9341_READ_DISPLAY_SIGNAL_MODE                    0x0E
+#define ILI9341_READ_DISPLAY_SELF_DIAGNOSTIC_RESULT         0x0F
+#define ILI9341_ENTER_SLEEP_MODE                            0x10
+#define ILI9341_SLEEP_OUT                                   0x11
+#define ILI9341_PARTIAL_MODE_ON                             0x12
+#define ILI9341_NORMAL_DISPLAY_MODE_ON                      0x13
+#define ILI9341_DISPLAY_INVERSION_OFF                       0x20
+#define ILI9341_DISPLAY_INVERSION_ON                        0x21
+#define ILI9341_SET_GAMMA                                   0x26
+#define ILI9341_DISPLAY_OFF                                 0x28
+#define ILI9341_DISPLAY_ON                                  0x29
+#define ILI9341_COLUMN_ADDR                                 0x2A
+#define ILI9341_PAGE_ADDR                                   0x2B
+#define ILI9341_WRITE_RAM                                   0x2C
+#define ILI9341_COLOR_SET                                   0x2D
+#define ILI9341_MEMORY_READ                                 0x2E
+#define ILI9341_PARTIAL_AREA                                0x30
+#define ILI9341_VERTICAL_SCROLLING_DEFINITION               0x33
+#define ILI9341_TEARING_EFFECT_LINE_OFF                     0x34
+#define ILI9341_TEARING_EFFECT_LINE_ON                      0x35
+#define ILI9341_MEMORY_ACCESS_CONTROL                       0x36
+#define ILI9341_VERTICAL_SCROLLING_START_ADDRESS            0x37
+#define ILI9341_IDLE_MODE_OFF                               0x38
+#define ILI9341_IDLE_MODE_ON                                0x39
+#define ILI9341_PIXEL_FORMAT                                0x3A
+#define ILI9341_WMC                                         0x3C
+#define ILI9341_RMC                                         0x3E
+#define ILI9341_SET_TEAR_SCANLINE                           0x44
+#define ILI9341_WDB                                         0x51
+#define ILI9341_READ_DISPLAY_BRIGHTNESS                     0x52
+#define ILI9341_WCD                                         0x53
+#define ILI9341_READ_CTRL_DISPLAY                           0x54
+#define ILI9341_WCABC                                       0x55
+#define ILI9341_RCABC                                       0x56
+#define ILI9341_WCABCMB                                     0x5E
+#define ILI9341_RCABCMB                                     0x5F
+#define ILI9341_RGB_INTERFACE                               0xB0
+#define ILI9341_FRAME_RATE_CONTROL							0xB1
+#define ILI9341_FRAME_CTRL_NM                               0xB2
+#define ILI9341_FRAME_CTRL_IM                               0xB3
+#define ILI9341_FRAME_CTRL_PM                               0xB4
+#define ILI9341_BPC                                         0xB5
+#define ILI9341_DISPLAY_FUNCTION_CONTROL                    0xB6
+#define ILI9341_ENTRY_MODE_SET                              0xB7
+#define ILI9341_BACKLIGHT_CONTROL_1                         0xB8
+#define ILI9341_BACKLIGHT_CONTROL_2                         0xB9
+#define ILI9341_BACKLIGHT_CONTROL_3                         0xBA
+#define ILI9341_BACKLIGHT_CONTROL_4                         0xBB
+#define ILI9341_BACKLIGHT_CONTROL_5                         0xBC
+#define ILI9341_BACKLIGHT_CONTROL_6                         0xBD
+#define ILI9341_BACKLIGHT_CONTROL_7                         0xBE
+#define ILI9341_BACKLIGHT_CONTROL_8                         0xBF
+#define ILI9341_POWER1                                      0xC0
+#define ILI9341_POWER2                                      0xC1
+#define ILI9341_VCOM1                                       0xC5
+#define ILI9341_VCOM2                                       0xC7
+#define ILI9341_POWERA                                      0xCB
+#define ILI9341_POWERB                                      0xCF
+#define ILI9341_READ_ID1                                    0xDA
+#define ILI9341_READ_ID2                                    0xDB
+#define ILI9341_READ_ID3                                    0xDC
+#define ILI9341_POSITIVE_GAMMA_CORRECTION                   0xE0
+#define ILI9341_NEGATIVE_GAMMA_CORRECTION                   0xE1
+#define ILI9341_DTCA                                        0xE8
+#define ILI9341_DTCB                                        0xEA
+#define ILI9341_POWER_SEQ                                   0xED
+#define ILI9341_3GAMMA_EN                                   0xF2
+#define ILI9341_INTERFACE                                   0xF6
+#define ILI9341_PRC                                         0xF7
+
 #endif  /* __ILI9341__ */
\ No newline at end of file
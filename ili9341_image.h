@@ -0,0 +1,41 @@
+#ifndef __ILI9341_IMAGE_H__
+#define __ILI9341_IMAGE_H__
+
+// Image formats the driver draws besides struct Image. Kept apart from ili9341.h, with no IDF headers, so host tools
+// like tools/image_compressor.c can build them.
+
+#include <stdint.h>
+
+// Palette indexed image with 1, 2, 4 or 8 bits per pixel. Pixels are packed most significant bits first and every row
+// starts on a new byte. The palette is stored in wire order, see reverseBytes.
+#define INDEXED_IMAGE_OPAQUE 0xFFFF
+
+typedef struct IndexedImage {
+	uint16_t width;
+	uint16_t height;
+	uint8_t bitsPerPixel;
+	uint16_t transparentIndex;	// Index left undrawn, or INDEXED_IMAGE_OPAQUE
+	const uint16_t* palette;
+	const uint8_t* data;
+} IndexedImage;
+
+// Compressed RGB565 image, as written by tools/image_compressor.c. Each row is a sequence of packets that never crosses
+// into the next row:
+//   0nnnnnnn hi lo           run of n + 1 pixels of one colour
+//   1nnnnnnn hi lo hi lo ... n + 1 literal pixels
+// Pixels are stored high byte first, the order they go out on the wire. rowIndex holds the byte offset of every
+// indexRows-th row, so decoding can start close to any row.
+#define COMPRESSED_IMAGE_LITERAL 0x80
+#define COMPRESSED_IMAGE_COUNT_MASK 0x7F
+#define COMPRESSED_IMAGE_MAX_PACKET 128
+#define COMPRESSED_IMAGE_INDEX_ROWS 16
+
+typedef struct CompressedImage {
+	uint16_t width;
+	uint16_t height;
+	uint16_t indexRows;
+	const uint32_t* rowIndex;
+	const uint8_t* data;
+} CompressedImage;
+
+#endif  /* __ILI9341_IMAGE_H__ */
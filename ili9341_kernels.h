@@ -0,0 +1,98 @@
+#ifndef __ILI9341_KERNELS_H__
+#define __ILI9341_KERNELS_H__
+
+// Span kernels every rasteriser in ili9341.c is built on. Spans are runs of RGB565 pixels in one row. Stores go out a
+// 32-bit word (two pixels) at a time once the destination is word aligned, unrolled four words deep. The ESP32 has no
+// 64-bit store, so words are as wide as it gets there. Both the ESP32 and the host are little endian, so the first
+// pixel of a pair is its low half.
+
+#include <stdint.h>
+#include <string.h>
+
+// Two neighbouring pixels, for writing the buffer a word at a time
+typedef uint32_t __attribute__((may_alias)) PixelPair;
+
+// Fills count pixels with a repeating pair of pixels. The low half of pattern lands on destination[0].
+static inline void spanFillPattern(uint16_t* destination, uint32_t pattern, uint32_t count)
+{
+    if (count > 0 && ((uintptr_t)destination & 2)) {
+        *destination++ = (uint16_t)pattern;
+        pattern = (pattern >> 16) | (pattern << 16);
+        --count;
+    }
+
+    PixelPair* pairs = (PixelPair*)destination;
+
+    for (; count >= 8; count -= 8, pairs += 4)
+    {
+        pairs[0] = pattern;
+        pairs[1] = pattern;
+        pairs[2] = pattern;
+        pairs[3] = pattern;
+    }
+    for (; count >= 2; count -= 2)
+    {
+        *pairs++ = pattern;
+    }
+
+    if (count > 0) {
+        *(uint16_t*)pairs = (uint16_t)pattern;
+    }
+}
+
+static inline void spanFill(uint16_t* destination, uint16_t colour, uint32_t count)
+{
+    spanFillPattern(destination, colour * 0x00010001u, count);
+}
+
+// The C library memcpy already copies a word at a time, and handles sources and destinations that do not line up
+static inline void spanCopy(uint16_t* destination, const uint16_t* source, uint32_t count)
+{
+    memcpy(destination, source, count * sizeof(uint16_t));
+}
+
+static inline uint32_t swapPairBytes(uint32_t pair)
+{
+    return ((pair & 0x00FF00FF) << 8) | ((pair >> 8) & 0x00FF00FF);
+}
+
+// Copies count pixels, swapping the bytes of each, which turns native RGB565 into wire order and back
+static inline void spanCopySwap(uint16_t* destination, const uint16_t* source, uint32_t count)
+{
+    if (count > 0 && ((uintptr_t)destination & 2)) {
+        uint16_t pixel = *source++;
+        *destination++ = (uint16_t)((pixel >> 8) | (pixel << 8));
+        --count;
+    }
+
+    PixelPair* pairs = (PixelPair*)destination;
+
+    if (((uintptr_t)source & 2) == 0) {
+        const PixelPair* sourcePairs = (const PixelPair*)source;
+
+        for (; count >= 8; count -= 8, pairs += 4, sourcePairs += 4)
+        {
+            pairs[0] = swapPairBytes(sourcePairs[0]);
+            pairs[1] = swapPairBytes(sourcePairs[1]);
+            pairs[2] = swapPairBytes(sourcePairs[2]);
+            pairs[3] = swapPairBytes(sourcePairs[3]);
+        }
+        for (; count >= 2; count -= 2)
+        {
+            *pairs++ = swapPairBytes(*sourcePairs++);
+        }
+        source = (const uint16_t*)sourcePairs;
+    } else {
+        // Source is off by a pixel, so build each word from two reads
+        for (; count >= 2; count -= 2, source += 2)
+        {
+            *pairs++ = swapPairBytes(source[0] | ((uint32_t)source[1] << 16));
+        }
+    }
+
+    if (count > 0) {
+        *(uint16_t*)pairs = (uint16_t)((*source >> 8) | (*source << 8));
+    }
+}
+
+#endif  /* __ILI9341_KERNELS_H__ */
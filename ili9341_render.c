@@ -0,0 +1,345 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <ili9341_render.h>
+#include <ili9341.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <stdio.h>
+
+// global_variables.h defines the project's globals, which ili9341.c already brings in, so this file keeps its own
+// tick conversion and error print
+#define RENDER_TICKS(ms) ((ms) / portTICK_PERIOD_MS)
+#define RENDER_ERROR(x, ...) printf("\x1b[31m" x "\x1b[0m\n", ##__VA_ARGS__)
+
+typedef enum RenderCommandType {
+    RENDER_FILL = 0,
+    RENDER_IMAGE,
+    RENDER_TEXT,
+    RENDER_TEXT_LABEL,
+    RENDER_LOADING_BAR,
+    RENDER_PROCESS_LOADING_CIRCLE,
+    RENDER_BAR_ADJUSTER,
+    RENDER_CALL
+} RenderCommandType;
+
+typedef struct RenderCommand {
+    TFT_t* dev;
+    uint8_t type;
+    uint8_t spacing;
+    bool normalizedWidth;
+    uint16_t x1;                    // Also centre or text x
+    uint16_t y1;
+    uint16_t x2;
+    uint16_t y2;
+    uint16_t colour;
+    struct FontxFile* fx;
+    union {
+        struct Image* image;
+        TextLabel* label;
+        intptr_t variable;
+        void* arg;
+    };
+    void (*function)(void* arg);
+    char text[TEXT_LABEL_MAX_LENGTH + 1];
+} RenderCommand;
+
+// Bounded multi-producer single-consumer ring. Each slot's sequence says whose turn it is: position when free for the
+// producer claiming that position, position + 1 once written, and position + RENDER_QUEUE_SIZE once the consumer is
+// done with it. Producers claim positions with a compare and swap, so none of them ever waits on another's write.
+typedef struct RenderSlot {
+    atomic_uint sequence;
+    RenderCommand command;
+} RenderSlot;
+
+static RenderSlot renderQueue[RENDER_QUEUE_SIZE];
+static atomic_uint enqueuePosition;
+static uint32_t dequeuePosition = 0;
+static atomic_uint renderedPosition;   // Everything before it is drawn and flushed
+
+static TaskHandle_t renderTask = NULL;
+
+static atomic_uint queuedCount;
+static atomic_uint droppedCount;
+static RenderQueueStats renderQueueStats;
+
+// Commands taken for the current frame, and whether a later one replaced them
+static RenderCommand batch[RENDER_QUEUE_SIZE];
+static bool replaced[RENDER_QUEUE_SIZE];
+
+// Queue
+// ------
+
+static bool enqueue(const RenderCommand* command)
+{
+    uint32_t position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+
+    for (;;) {
+        RenderSlot* slot = &renderQueue[position & (RENDER_QUEUE_SIZE - 1)];
+        int32_t turn = (int32_t)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - position);
+
+        if (turn == 0) {
+            // On failure position is reloaded, and another producer got this slot
+            if (atomic_compare_exchange_weak_explicit(&enqueuePosition, &position, position + 1, memory_order_relaxed, memory_order_relaxed)) {
+                slot->command = *command;
+                atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+                break;
+            }
+        } else if (turn < 0) {
+            // The consumer has not finished with this slot from one lap ago, so the queue is full
+            atomic_fetch_add_explicit(&droppedCount, 1, memory_order_relaxed);
+            return false;
+        } else {
+            position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+        }
+    }
+
+    atomic_fetch_add_explicit(&queuedCount, 1, memory_order_relaxed);
+
+    if (renderTask != NULL) {
+        xTaskNotifyGive(renderTask);
+    }
+    return true;
+}
+
+static bool dequeue(RenderCommand* command)
+{
+    RenderSlot* slot = &renderQueue[dequeuePosition & (RENDER_QUEUE_SIZE - 1)];
+
+    // A producer that claimed the slot but has not written it yet holds up the rest until the next frame
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != dequeuePosition + 1) {
+        return false;
+    }
+
+    *command = slot->command;
+    atomic_store_explicit(&slot->sequence, dequeuePosition + RENDER_QUEUE_SIZE, memory_order_release);
+    ++dequeuePosition;
+    return true;
+}
+
+// Render task
+// ------------
+
+// Widgets and labels redraw completely from their variable or text, so an earlier update of the same one is wasted
+static bool replaces(const RenderCommand* later, const RenderCommand* earlier)
+{
+    if (later->type != earlier->type || later->dev != earlier->dev) {
+        return false;
+    }
+
+    switch (later->type) {
+        case RENDER_TEXT_LABEL:
+            return later->label == earlier->label;
+        case RENDER_LOADING_BAR:
+        case RENDER_PROCESS_LOADING_CIRCLE:
+        case RENDER_BAR_ADJUSTER:
+            return later->x1 == earlier->x1 && later->y1 == earlier->y1;
+        default:
+            return false;
+    }
+}
+
+static void runCommand(RenderCommand* command)
+{
+    switch (command->type) {
+        case RENDER_FILL:
+            fillBufferAreaWithColour(command->dev, command->x1, command->y1, command->x2, command->y2, command->colour);
+            break;
+        case RENDER_IMAGE:
+            fillBufferAreaWithImage(command->dev, command->x1, command->y1, command->image);
+            break;
+        case RENDER_TEXT:
+            writeText(command->dev, command->text, command->spacing, command->normalizedWidth, command->fx, command->x1, command->y1, command->colour);
+            break;
+        case RENDER_TEXT_LABEL:
+            updateTextLabel(command->dev, command->label, command->text);
+            break;
+        case RENDER_LOADING_BAR:
+            loadingBar(command->dev, command->x1, command->y1, command->variable);
+            break;
+        case RENDER_PROCESS_LOADING_CIRCLE:
+            processLoadingCircle(command->dev, command->x1, command->y1, command->variable);
+            break;
+        case RENDER_BAR_ADJUSTER:
+            barAdjuster(command->dev, command->x1, command->y1, command->variable);
+            break;
+        case RENDER_CALL:
+            command->function(command->arg);
+            break;
+    }
+}
+
+static void renderLoop(void* parameters)
+{
+    TickType_t frameTicks = RENDER_TICKS(RENDER_FRAME_MS) > 0 ? RENDER_TICKS(RENDER_FRAME_MS) : 1;
+    TickType_t frameStart = xTaskGetTickCount();
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // vTaskDelayUntil only moves the frame on by one period, so after idling it would let a frame through without
+        // a delay for every period slept. Count frames from now instead.
+        TickType_t now = xTaskGetTickCount();
+
+        if ((TickType_t)(now - frameStart) > frameTicks) {
+            frameStart = now;
+        }
+
+        uint8_t count = 0;
+
+        while (count < RENDER_QUEUE_SIZE && dequeue(&batch[count])) {
+            replaced[count] = false;
+
+            for (uint8_t i = 0; i < count; ++i)
+            {
+                if (!replaced[i] && replaces(&batch[count], &batch[i])) {
+                    replaced[i] = true;
+                    ++renderQueueStats.coalesced;
+                }
+            }
+            ++count;
+        }
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            if (!replaced[i]) {
+                runCommand(&batch[i]);
+                ++renderQueueStats.drawn;
+            }
+        }
+
+        // Every screen drawn on this frame, each flushed once
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            bool flushed = batch[i].dev == NULL;
+
+            for (uint8_t j = 0; j < i && !flushed; ++j)
+            {
+                flushed = batch[j].dev == batch[i].dev;
+            }
+            if (!flushed) {
+                flushDirty(batch[i].dev);
+            }
+        }
+
+        if (count > renderQueueStats.maxDepth) {
+            renderQueueStats.maxDepth = count;
+        }
+        ++renderQueueStats.frames;
+        atomic_store_explicit(&renderedPosition, dequeuePosition, memory_order_release);
+
+        // Whatever was left behind, or came in while drawing, goes in the next frame
+        if (atomic_load_explicit(&enqueuePosition, memory_order_relaxed) != dequeuePosition) {
+            xTaskNotifyGive(renderTask);
+        }
+        vTaskDelayUntil(&frameStart, frameTicks);
+    }
+}
+
+bool startRenderTask()
+{
+    if (renderTask != NULL) {
+        RENDER_ERROR("Render task already running");
+        return false;
+    }
+
+    for (uint32_t i = 0; i < RENDER_QUEUE_SIZE; ++i)
+    {
+        atomic_init(&renderQueue[i].sequence, i);
+    }
+    atomic_init(&enqueuePosition, 0);
+    atomic_init(&renderedPosition, 0);
+    dequeuePosition = 0;
+
+    if (xTaskCreatePinnedToCore(renderLoop, "render", RENDER_TASK_STACK_SIZE, NULL, RENDER_TASK_PRIORITY, &renderTask, RENDER_TASK_CORE) != pdPASS) {
+        RENDER_ERROR("Could not start render task");
+        renderTask = NULL;
+        return false;
+    }
+    return true;
+}
+
+// Producers
+// ----------
+
+bool renderFill(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_FILL, .x1 = x1, .y1 = y1, .x2 = x2, .y2 = y2, .colour = colour };
+    return enqueue(&command);
+}
+
+bool renderImage(TFT_t* dev, uint16_t x1, uint16_t y1, struct Image* image)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_IMAGE, .x1 = x1, .y1 = y1, .image = image };
+    return enqueue(&command);
+}
+
+bool renderText(TFT_t* dev, const char* text, uint8_t spacing, bool normalizedWidth, struct FontxFile* fx, uint16_t x, uint16_t y, uint16_t textColour)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_TEXT, .spacing = spacing, .normalizedWidth = normalizedWidth, .fx = fx, .x1 = x, .y1 = y, .colour = textColour };
+
+    if (strlen(text) > TEXT_LABEL_MAX_LENGTH) {
+        RENDER_ERROR("Text longer than %i chars cannot be queued", TEXT_LABEL_MAX_LENGTH);
+        return false;
+    }
+
+    strcpy(command.text, text);
+    return enqueue(&command);
+}
+
+bool renderTextLabel(TFT_t* dev, TextLabel* label, const char* text)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_TEXT_LABEL, .label = label };
+
+    if (strlen(text) > TEXT_LABEL_MAX_LENGTH) {
+        RENDER_ERROR("Text longer than %i chars cannot be queued", TEXT_LABEL_MAX_LENGTH);
+        return false;
+    }
+
+    strcpy(command.text, text);
+    return enqueue(&command);
+}
+
+bool renderLoadingBar(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_LOADING_BAR, .x1 = centerX, .y1 = centerY, .variable = variable };
+    return enqueue(&command);
+}
+
+bool renderProcessLoadingCircle(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_PROCESS_LOADING_CIRCLE, .x1 = centerX, .y1 = centerY, .variable = variable };
+    return enqueue(&command);
+}
+
+bool renderBarAdjuster(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable)
+{
+    RenderCommand command = { .dev = dev, .type = RENDER_BAR_ADJUSTER, .x1 = centerX, .y1 = centerY, .variable = variable };
+    return enqueue(&command);
+}
+
+bool renderCall(void (*function)(void* arg), void* arg)
+{
+    RenderCommand command = { .type = RENDER_CALL, .function = function, .arg = arg };
+    return enqueue(&command);
+}
+
+bool waitForRenderQueue(TickType_t ticksToWait)
+{
+    uint32_t target = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+    TickType_t start = xTaskGetTickCount();
+
+    while ((int32_t)(atomic_load_explicit(&renderedPosition, memory_order_acquire) - target) < 0) {
+        if (ticksToWait != portMAX_DELAY && xTaskGetTickCount() - start >= ticksToWait) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+void getRenderQueueStats(RenderQueueStats* stats)
+{
+    *stats = renderQueueStats;
+    stats->queued = atomic_load_explicit(&queuedCount, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&droppedCount, memory_order_relaxed);
+}
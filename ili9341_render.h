@@ -0,0 +1,49 @@
+#ifndef __ILI9341_RENDER_H__
+#define __ILI9341_RENDER_H__
+
+// Render service. One task owns the screens and every other task hands it draw commands through a lock-free queue, so
+// sensor and button tasks never wait on the SPI bus. A full queue drops the command and counts it rather than block.
+// Once a frame the task takes everything queued, keeps only the latest of the widget and label updates that redraw
+// the same thing, draws the rest in order and flushes the dirty areas of every screen it drew on. Nothing else may
+// call the driver once the task is running.
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <ili9341.h>
+
+#define RENDER_QUEUE_SIZE 32            // Power of two
+#define RENDER_TASK_STACK_SIZE 4096
+#define RENDER_TASK_PRIORITY 5
+#define RENDER_TASK_CORE 1
+#define RENDER_FRAME_MS 20              // Shortest time between frames, which is what lets updates pile up and coalesce
+
+typedef struct RenderQueueStats {
+	uint32_t queued;
+	uint32_t dropped;					// Queue full
+	uint32_t drawn;
+	uint32_t coalesced;					// Replaced by a later update of the same widget or label
+	uint32_t frames;
+	uint8_t maxDepth;					// Most commands taken in one frame
+} RenderQueueStats;
+
+bool startRenderTask();
+
+// Same arguments as the driver functions they stand for, screen included. Text is copied, up to TEXT_LABEL_MAX_LENGTH
+// chars.
+bool renderFill(TFT_t* dev, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2, uint16_t colour);
+bool renderImage(TFT_t* dev, uint16_t x1, uint16_t y1, struct Image* image);
+bool renderText(TFT_t* dev, const char* text, uint8_t spacing, bool normalizedWidth, struct FontxFile* fx, uint16_t x, uint16_t y, uint16_t textColour);
+bool renderTextLabel(TFT_t* dev, TextLabel* label, const char* text);
+bool renderLoadingBar(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable);
+bool renderProcessLoadingCircle(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable);
+bool renderBarAdjuster(TFT_t* dev, uint16_t centerX, uint16_t centerY, intptr_t variable);
+
+// Runs function on the render task, in order with the draw commands around it
+bool renderCall(void (*function)(void* arg), void* arg);
+
+// Waits until everything queued so far is drawn and flushed. Returns false on timeout.
+bool waitForRenderQueue(TickType_t ticksToWait);
+
+void getRenderQueueStats(RenderQueueStats* stats);
+
+#endif  /* __ILI9341_RENDER_H__ */
@@ -0,0 +1,144 @@
+#include <freertos/FreeRTOS.h>
+#include <esp_timer.h>
+#include <ili9341_trace.h>
+#include <string.h>
+
+// Records are never split. One that does not fit before the end of the buffer goes to the start, and the trace then
+// runs from oldest to wrapEnd, and on from the start of the buffer to end.
+static uint8_t* traceBuffer = NULL;
+static uint32_t traceSize = 0;
+static uint32_t oldest = 0;
+static uint32_t end = 0;
+static uint32_t wrapEnd = 0;
+static bool wrapped = false;
+static SpiTraceMode traceMode = SPI_TRACE_NO_PIXELS;
+static SpiTraceStats traceStats;
+
+// Screens may send from several tasks
+static portMUX_TYPE traceLock = portMUX_INITIALIZER_UNLOCKED;
+
+void startSpiTrace(uint8_t* buffer, uint32_t size, SpiTraceMode mode)
+{
+    portENTER_CRITICAL(&traceLock);
+    traceBuffer = buffer;
+    traceSize = size;
+    traceMode = mode;
+    oldest = 0;
+    end = 0;
+    wrapEnd = 0;
+    wrapped = false;
+    memset(&traceStats, 0, sizeof(SpiTraceStats));
+    portEXIT_CRITICAL(&traceLock);
+}
+
+void stopSpiTrace()
+{
+    portENTER_CRITICAL(&traceLock);
+    traceSize = 0;
+    portEXIT_CRITICAL(&traceLock);
+}
+
+// Makes room for length bytes at end, dropping the oldest records in the way
+static void makeRoom(uint32_t length)
+{
+    for (;;) {
+        if (!wrapped) {
+            if (end + length <= traceSize) {
+                return;
+            }
+            wrapped = true;
+            wrapEnd = end;
+            end = 0;
+        } else {
+            if (end + length <= oldest) {
+                return;
+            }
+            oldest += spiTraceRecordLength((const SpiTraceRecord*)&traceBuffer[oldest]);
+            ++traceStats.overwritten;
+
+            if (oldest >= wrapEnd) {
+                oldest = 0;
+                wrapped = false;
+            }
+        }
+    }
+}
+
+void recordSpiTransaction(uint8_t screen, SpiTraceKind kind, bool data, const uint8_t* bytes, uint32_t length)
+{
+    if (traceSize == 0) {
+        return;
+    }
+
+    SpiTraceRecord record = {
+        .timeUs = (uint32_t)esp_timer_get_time(),
+        .length = length,
+        .flags = (data ? SPI_TRACE_DATA : 0) | (kind << 1),
+        .screen = screen
+    };
+    uint32_t hash = 0;
+
+    if (length <= SPI_TRACE_INLINE_BYTES || traceMode == SPI_TRACE_PIXELS) {
+        record.flags |= SPI_TRACE_PAYLOAD;
+    } else if (traceMode == SPI_TRACE_PIXEL_HASHES) {
+        // Hashed outside the lock, as it takes a while for a full strip
+        record.flags |= SPI_TRACE_HASH;
+        hash = spiTraceHash(bytes, length);
+    }
+
+    uint32_t recordLength = spiTraceRecordLength(&record);
+
+    portENTER_CRITICAL(&traceLock);
+
+    if (traceSize == 0) {
+        portEXIT_CRITICAL(&traceLock);
+        return;
+    }
+    if (recordLength > traceSize) {
+        ++traceStats.tooLong;
+        portEXIT_CRITICAL(&traceLock);
+        return;
+    }
+
+    makeRoom(recordLength);
+
+    memcpy(&traceBuffer[end], &record, sizeof(SpiTraceRecord));
+    if (record.flags & SPI_TRACE_PAYLOAD) {
+        memcpy(&traceBuffer[end + sizeof(SpiTraceRecord)], bytes, length);
+    } else if (record.flags & SPI_TRACE_HASH) {
+        memcpy(&traceBuffer[end + sizeof(SpiTraceRecord)], &hash, sizeof(uint32_t));
+    }
+    end += recordLength;
+    ++traceStats.recorded;
+
+    portEXIT_CRITICAL(&traceLock);
+}
+
+void getSpiTrace(const uint8_t** first, uint32_t* firstLength, const uint8_t** second, uint32_t* secondLength)
+{
+    portENTER_CRITICAL(&traceLock);
+
+    if (traceBuffer == NULL) {
+        *first = *second = NULL;
+        *firstLength = *secondLength = 0;
+    } else if (wrapped) {
+        *first = &traceBuffer[oldest];
+        *firstLength = wrapEnd - oldest;
+        *second = traceBuffer;
+        *secondLength = end;
+    } else {
+        *first = &traceBuffer[oldest];
+        *firstLength = end - oldest;
+        *second = traceBuffer;
+        *secondLength = 0;
+    }
+
+    portEXIT_CRITICAL(&traceLock);
+}
+
+void getSpiTraceStats(SpiTraceStats* stats)
+{
+    portENTER_CRITICAL(&traceLock);
+    *stats = traceStats;
+    portEXIT_CRITICAL(&traceLock);
+}
@@ -0,0 +1,81 @@
+#ifndef __ILI9341_TRACE_H__
+#define __ILI9341_TRACE_H__
+
+// SPI trace recorder. With SCREEN_SPI_TRACE defined, the driver records every transaction it hands to the SPI driver
+// into a ring buffer the application provides, dropping the oldest records once it is full. A trace saved from a unit
+// is replayed offline into the host simulator by tools/spi_replay.c.
+//
+// A trace is a sequence of records, oldest first, each an SpiTraceRecord followed by what its flags say: the bytes
+// sent, their 32-bit FNV-1a hash, or nothing. Everything is little endian.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Transactions up to this many bytes, which is every command and its arguments, are always recorded in full
+#define SPI_TRACE_INLINE_BYTES 16
+
+// How transactions longer than SPI_TRACE_INLINE_BYTES, which are pixels, are recorded
+typedef enum SpiTraceMode {
+	SPI_TRACE_NO_PIXELS = 0,			// Length only
+	SPI_TRACE_PIXEL_HASHES,				// Length and hash, enough to tell repeated writes apart
+	SPI_TRACE_PIXELS					// Every byte
+} SpiTraceMode;
+
+#define SPI_TRACE_DATA			0x01	// D/C was high
+#define SPI_TRACE_KIND_MASK		0x06	// SpiTraceKind << 1
+#define SPI_TRACE_PAYLOAD		0x08	// The bytes sent follow
+#define SPI_TRACE_HASH			0x10	// Their hash follows
+
+typedef enum SpiTraceKind {
+	SPI_TRACE_QUEUED = 0,
+	SPI_TRACE_BLOCKING,
+	SPI_TRACE_POLLING
+} SpiTraceKind;
+
+typedef struct __attribute__((packed)) SpiTraceRecord {
+	uint32_t timeUs;					// esp_timer_get_time when the transaction was handed over, which for a queued one
+										// can be well before it goes out
+	uint16_t length;					// Bytes
+	uint8_t flags;
+	uint8_t screen;						// CS pin of the screen, 0xFF when it has none
+} SpiTraceRecord;
+
+typedef struct SpiTraceStats {
+	uint32_t recorded;
+	uint32_t overwritten;				// Oldest records dropped to make room
+	uint32_t tooLong;					// Records bigger than the whole buffer, never stored
+} SpiTraceStats;
+
+// Starts recording into buffer, which is kept until stopSpiTrace. Any trace in it before is forgotten.
+void startSpiTrace(uint8_t* buffer, uint32_t size, SpiTraceMode mode);
+void stopSpiTrace();
+
+// The trace is at most two runs of whole records in the buffer: first, then second, which is empty unless recording
+// wrapped around. Stop the trace, or make sure no screen is sending, before reading them.
+void getSpiTrace(const uint8_t** first, uint32_t* firstLength, const uint8_t** second, uint32_t* secondLength);
+void getSpiTraceStats(SpiTraceStats* stats);
+
+static inline uint32_t spiTraceRecordLength(const SpiTraceRecord* record)
+{
+    if (record->flags & SPI_TRACE_PAYLOAD) {
+        return sizeof(SpiTraceRecord) + record->length;
+    }
+    return sizeof(SpiTraceRecord) + ((record->flags & SPI_TRACE_HASH) ? sizeof(uint32_t) : 0);
+}
+
+// FNV-1a
+static inline uint32_t spiTraceHash(const uint8_t* bytes, uint32_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Called by the driver for every transaction
+void recordSpiTransaction(uint8_t screen, SpiTraceKind kind, bool data, const uint8_t* bytes, uint32_t length);
+
+#endif  /* __ILI9341_TRACE_H__ */
@@ -0,0 +1,134 @@
+// Checks that the build modes agree pixel for pixel. Draws the host scene (see host_scene.h) and either writes the
+// simulator GRAM at every checkpoint to a file, or compares it against a file written by another build. Writing from
+// the framebuffer build and comparing from a SCREEN_STRIP_RENDERER build shows that the display list renders exactly
+// what the framebuffer holds, and comparing from a SCREEN_WIRE_ORDER build shows that colours given in wire order put
+// the same pixels on the panel as colours converted on the way out. SCREEN_INDEXED_FRAMEBUFFER rounds colours to its
+// palette, so it only compares against itself.
+//
+// Build: gcc -std=gnu11 -O2 -pthread -Ihost -Itests/stubs -Itests -I. -o host_modes tests/host_modes.c
+//        tests/host_scene.c tests/stubs/stubs.c ili9341.c ili9341_trace.c host/*.c [-DSCREEN_STRIP_RENDERER ...]
+// Usage: host_modes --write file | --compare file
+
+#include <freertos/FreeRTOS.h>
+#include <ili9341_simulator.h>
+#include <host_scene.h>
+#include <ili9341.h>
+#include <pinmap.h>
+#include <string.h>
+#include <stdio.h>
+
+#define CHECKPOINT_NAME_LENGTH 16
+
+#ifdef SCREEN_STRIP_RENDERER
+#define BUILD_MODE "strip"
+#elif defined(SCREEN_INDEXED_FRAMEBUFFER)
+#define BUILD_MODE "indexed framebuffer"
+#else
+#define BUILD_MODE "framebuffer"
+#endif
+
+#ifdef SCREEN_WIRE_ORDER
+#define COLOUR_ORDER ", wire order colours"
+#else
+#define COLOUR_ORDER ""
+#endif
+
+// One record per checkpoint, in the order the scene reaches them
+typedef struct GramRecord {
+    char checkpoint[CHECKPOINT_NAME_LENGTH];
+    uint16_t gram[SIMULATOR_GRAM_HEIGHT][SIMULATOR_GRAM_WIDTH];
+} GramRecord;
+
+static Ili9341Simulator sim;
+static TFT_t screen;
+static FILE* file = NULL;
+static bool writing = false;
+static GramRecord record;
+static uint8_t checkpointCount = 0;
+static uint8_t failures = 0;
+
+static void writeGram(const char* name)
+{
+    memset(&record, 0, sizeof(GramRecord));
+    strncpy(record.checkpoint, name, CHECKPOINT_NAME_LENGTH - 1);
+    memcpy(record.gram, sim.gram, sizeof(record.gram));
+
+    if (fwrite(&record, sizeof(GramRecord), 1, file) != 1) {
+        printf("%-8s could not be written\n", name);
+        ++failures;
+        return;
+    }
+    ++checkpointCount;
+    printf("%-8s written\n", name);
+}
+
+static void compareGram(const char* name)
+{
+    if (fread(&record, sizeof(GramRecord), 1, file) != 1) {
+        printf("%-8s missing from the file\n", name);
+        ++failures;
+        return;
+    }
+    ++checkpointCount;
+
+    if (strncmp(record.checkpoint, name, CHECKPOINT_NAME_LENGTH) != 0) {
+        printf("%-8s found %s in the file instead\n", name, record.checkpoint);
+        ++failures;
+        return;
+    }
+    if (memcmp(record.gram, sim.gram, sizeof(record.gram)) == 0) {
+        printf("%-8s identical\n", name);
+        return;
+    }
+
+    uint32_t differing = 0;
+    int32_t firstX = -1;
+    int32_t firstY = -1;
+
+    for (uint16_t y = 0; y < SIMULATOR_GRAM_HEIGHT; ++y)
+    {
+        for (uint16_t x = 0; x < SIMULATOR_GRAM_WIDTH; ++x)
+        {
+            if (record.gram[y][x] != sim.gram[y][x]) {
+                if (differing++ == 0) {
+                    firstX = x;
+                    firstY = y;
+                }
+            }
+        }
+    }
+    printf("%-8s %u pixels differ, first at %i,%i: 0x%04X, expected 0x%04X\n", name, differing, firstX, firstY,
+           sim.gram[firstY][firstX], record.gram[firstY][firstX]);
+    ++failures;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && (strcmp(argv[1], "--write") == 0 || strcmp(argv[1], "--compare") == 0)) {
+        writing = (strcmp(argv[1], "--write") == 0);
+    } else {
+        fprintf(stderr, "Usage: %s --write file | --compare file\n", argv[0]);
+        return 1;
+    }
+
+    file = fopen(argv[2], writing ? "wb" : "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        return 1;
+    }
+
+    simulatorInit(&sim, SCREEN_DC_PIN);
+    simulatorAttach(&sim);
+    if (!setupScreen(&screen, NULL)) {
+        fclose(file);
+        return 1;
+    }
+
+    printf("%s build%s\n", BUILD_MODE, COLOUR_ORDER);
+    bool correct = drawHostScene(&screen, writing ? writeGram : compareGram);
+    correct = correct && checkpointCount == HOST_SCENE_CHECKPOINTS && failures == 0;
+
+    fclose(file);
+    printf("%s\n", correct ? "PASS" : "FAIL");
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+// Checks frame pacing against the simulated panel scan. Sends random rows, areas and full screens at random times and
+// counts the memory writes the scan showed partly old and partly new. At SCREEN_FRAME_RATE every send fits between two
+// refreshes, so none may tear. At 119 Hz full screen writes are too slow to ever fit, so some tear, and every one of
+// them must have been reported as a deadline miss. Then the content is scrolled, once over the whole screen and once
+// between fixed areas, so rows are scanned out of order. Sends are split where the scan lines stop following the rows,
+// which leaves runs short enough to fit at either rate, so nothing may tear and the misses must still agree.
+//
+// Build: gcc -std=gnu11 -O2 -pthread -Ihost -Itests/stubs -Itests -I. -o host_pacing tests/host_pacing.c
+//        tests/stubs/stubs.c ili9341.c ili9341_trace.c host/*.c -DSCREEN_FRAME_PACING
+// Usage: host_pacing
+
+#include <freertos/FreeRTOS.h>
+#include <ili9341_simulator.h>
+#include <esp_rom_sys.h>
+#include <ili9341.h>
+#include <pinmap.h>
+#include <stdio.h>
+
+#ifndef SCREEN_FRAME_PACING
+#error "host_pacing needs SCREEN_FRAME_PACING"
+#endif
+
+#define PACING_SENDS 300
+
+typedef enum ExpectedTears {
+    NO_TEARS = 0,
+    SOME_TEARS                  // Reported as deadline misses, and at least one
+} ExpectedTears;
+
+static Ili9341Simulator sim;
+static TFT_t screen;
+static uint32_t seed = 1;
+
+static uint32_t pacingRandom()
+{
+    seed = (seed * 1103515245u) + 12345u;
+    return seed >> 8;
+}
+
+// Returns false when a draw or send fails, or when the torn writes do not agree with the pacing stats
+static bool runSends(const char* name, uint8_t framesPerSecond, ExpectedTears expected)
+{
+    if (!setFrameRate(&screen, framesPerSecond)) {
+        return false;
+    }
+    simulatorResetStats(&sim);
+    resetFramePacingStats(&screen);
+
+    for (uint16_t i = 0; i < PACING_SENDS; ++i)
+    {
+        esp_rom_delay_us(pacingRandom() % 20000);
+
+        uint16_t colour = pacingRandom();
+        bool sent;
+
+        if (i % 3 == 0) {
+            sent = fillEntireBufferWithColour(&screen, colour) && sendEntireBuffer(&screen);
+        } else {
+            uint16_t y1 = pacingRandom() % 300;
+            uint16_t height = 1 + (pacingRandom() % (SCREEN_HEIGHT - y1));
+            uint16_t x1 = 0;
+            uint16_t width = SCREEN_WIDTH;
+
+            // Whole rows, or a rectangle for every third send
+            if (i % 3 == 2) {
+                x1 = pacingRandom() % 200;
+                width = 1 + (pacingRandom() % (SCREEN_WIDTH - x1));
+            }
+            sent = fillBufferAreaWithColour(&screen, x1, y1, x1 + width, y1 + height, colour)
+                && sendBufferArea(&screen, x1, y1, x1 + width - 1, y1 + height - 1);
+        }
+
+        if (!sent) {
+            printf("%-10s %3u Hz: send %u failed\n", name, framesPerSecond, i);
+            return false;
+        }
+    }
+
+    FramePacingStats stats;
+    getFramePacingStats(&screen, &stats);
+
+    printf("%-10s %3u Hz: %u sends, %u waits, %u deadline misses, %u torn writes\n", name, framesPerSecond, stats.sends,
+           stats.waits, stats.deadlineMisses, sim.stats.tornMemoryWrites);
+
+    if (sim.stats.tornMemoryWrites != stats.deadlineMisses) {
+        return false;
+    }
+    return (expected == SOME_TEARS) ? stats.deadlineMisses > 0 : sim.stats.tornMemoryWrites == 0;
+}
+
+int main()
+{
+    simulatorInit(&sim, SCREEN_DC_PIN);
+    simulatorAttach(&sim);
+    if (!setupScreen(&screen, NULL)) {
+        return 1;
+    }
+
+    bool correct = runSends("unscrolled", SCREEN_FRAME_RATE, NO_TEARS);
+    correct = runSends("unscrolled", 119, SOME_TEARS) && correct;
+
+    if (!setScrollArea(&screen, 0, 0) || !scrollScreen(&screen, 160)) {
+        return 1;
+    }
+    correct = runSends("scrolled", SCREEN_FRAME_RATE, NO_TEARS) && correct;
+    correct = runSends("scrolled", 119, NO_TEARS) && correct;
+
+    if (!setScrollArea(&screen, 40, 60) || !scrollScreen(&screen, 100)) {
+        return 1;
+    }
+    correct = runSends("fixed", SCREEN_FRAME_RATE, NO_TEARS) && correct;
+    correct = runSends("fixed", 119, NO_TEARS) && correct;
+
+    printf("%s\n", correct ? "PASS" : "FAIL");
+    return correct ? 0 : 1;
+}
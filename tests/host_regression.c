@@ -0,0 +1,105 @@
+// Pixel-exact regression test for the rendering and transport paths. Draws the host scene (see host_scene.h) through
+// the simulated controller and checks a hash of GRAM at every checkpoint against the hashes the driver is known to
+// produce. The same hashes hold for the framebuffer, SCREEN_STRIP_RENDERER and SCREEN_WIRE_ORDER builds;
+// SCREEN_INDEXED_FRAMEBUFFER has its own, as its colours are the nearest palette entries. A change that is meant to
+// alter the output needs the hashes updated, with the PPM dumps looked over first.
+//
+// Build: gcc -std=gnu11 -O2 -pthread -Ihost -Itests/stubs -Itests -I. -o host_regression tests/host_regression.c
+//        tests/host_scene.c tests/stubs/stubs.c ili9341.c ili9341_trace.c host/*.c [-DSCREEN_STRIP_RENDERER ...]
+// Usage: host_regression [--ppm prefix, writes prefix-checkpoint.ppm for every checkpoint]
+
+#include <freertos/FreeRTOS.h>
+#include <ili9341_simulator.h>
+#include <host_scene.h>
+#include <ili9341.h>
+#include <pinmap.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef struct ExpectedGram {
+    const char* checkpoint;
+    uint32_t hash;
+} ExpectedGram;
+
+#ifdef SCREEN_INDEXED_FRAMEBUFFER
+static const ExpectedGram expected[HOST_SCENE_CHECKPOINTS] = {
+    { "text", 0x7EF0E5AE },
+    { "images", 0x3C530DCB },
+    { "widgets", 0xE69CE13A },
+    { "random", 0xC23CE3B6 },
+    { "full", 0x6D06E068 }
+};
+#else
+static const ExpectedGram expected[HOST_SCENE_CHECKPOINTS] = {
+    { "text", 0xE5258BC8 },
+    { "images", 0xC69A4B9C },
+    { "widgets", 0xF4F68D02 },
+    { "random", 0x326A9A9F },
+    { "full", 0x05D99D8C }
+};
+#endif
+
+static Ili9341Simulator sim;
+static TFT_t screen;
+static const char* ppmPrefix = NULL;
+static uint8_t checkpointCount = 0;
+static uint8_t failures = 0;
+
+// FNV-1a over GRAM, row by row
+static uint32_t hashGram()
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint16_t y = 0; y < SIMULATOR_GRAM_HEIGHT; ++y)
+    {
+        for (uint16_t x = 0; x < SIMULATOR_GRAM_WIDTH; ++x)
+        {
+            hash = (hash ^ (sim.gram[y][x] >> 8)) * 16777619u;
+            hash = (hash ^ (sim.gram[y][x] & 0xFF)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+static void checkGram(const char* name)
+{
+    const ExpectedGram* want = &expected[checkpointCount++];
+    uint32_t hash = hashGram();
+
+    if (strcmp(want->checkpoint, name) != 0 || hash != want->hash) {
+        printf("%-8s 0x%08X, expected 0x%08X\n", name, hash, want->hash);
+        ++failures;
+    } else {
+        printf("%-8s 0x%08X\n", name, hash);
+    }
+
+    if (ppmPrefix != NULL) {
+        char path[256];
+
+        snprintf(path, sizeof(path), "%s-%s.ppm", ppmPrefix, name);
+        if (!simulatorDumpPpm(&sim, path, false)) {
+            fprintf(stderr, "Could not write %s\n", path);
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 3 && strcmp(argv[1], "--ppm") == 0) {
+        ppmPrefix = argv[2];
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [--ppm prefix]\n", argv[0]);
+        return 1;
+    }
+
+    simulatorInit(&sim, SCREEN_DC_PIN);
+    simulatorAttach(&sim);
+    if (!setupScreen(&screen, NULL)) {
+        return 1;
+    }
+
+    bool correct = drawHostScene(&screen, checkGram) && checkpointCount == HOST_SCENE_CHECKPOINTS && failures == 0;
+
+    printf("%s\n", correct ? "PASS" : "FAIL");
+    return correct ? 0 : 1;
+}
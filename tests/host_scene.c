@@ -0,0 +1,212 @@
+#include <freertos/FreeRTOS.h>
+#include <host_scene.h>
+#include <colours.h>
+#include <images.h>
+#include <fonts.h>
+#include <settings.h>
+#include <stdio.h>
+
+#define COMPRESSED_WIDTH 64
+#define COMPRESSED_HEIGHT 48
+#define INDEXED_SIZE 40
+
+static uint8_t compressedData[COMPRESSED_HEIGHT * 3 * 2];
+static uint32_t compressedRowIndex[(COMPRESSED_HEIGHT / COMPRESSED_IMAGE_INDEX_ROWS) + 1];
+static CompressedImage compressedImage = { COMPRESSED_WIDTH, COMPRESSED_HEIGHT, COMPRESSED_IMAGE_INDEX_ROWS, compressedRowIndex, compressedData };
+
+static uint16_t indexedPalette[16];
+static uint8_t indexedData[INDEXED_SIZE * INDEXED_SIZE / 2];
+static IndexedImage indexedImage = { INDEXED_SIZE, INDEXED_SIZE, 4, 0, indexedPalette, indexedData };
+
+static uint32_t sceneSeed = 1;
+
+// Same numbers on every platform, unlike rand
+static uint32_t sceneRandom()
+{
+    sceneSeed = (sceneSeed * 1103515245u) + 12345u;
+    return sceneSeed >> 8;
+}
+
+static void buildImages()
+{
+    uint16_t* background = (uint16_t*)loadingBarBackground.data;
+    uint32_t offset = 0;
+
+    for (uint32_t i = 0; i < (uint32_t)loadingBarBackground.width * loadingBarBackground.height; ++i)
+    {
+        background[i] = SCREEN_COLOUR((uint16_t)((i * 2654435761u) >> 16));
+    }
+
+    // Compressed pixels are always high byte first. Each row is a run of one colour and a run of another.
+    for (uint16_t row = 0; row < COMPRESSED_HEIGHT; ++row)
+    {
+        uint8_t split = 8 + row;
+        uint16_t colours[2] = { (uint16_t)(row * 0x0841), (uint16_t)(0xF800 | (row << 5)) };
+        uint8_t lengths[2] = { split, COMPRESSED_WIDTH - split };
+
+        if (row % COMPRESSED_IMAGE_INDEX_ROWS == 0) {
+            compressedRowIndex[row / COMPRESSED_IMAGE_INDEX_ROWS] = offset;
+        }
+        for (uint8_t run = 0; run < 2; ++run)
+        {
+            compressedData[offset++] = lengths[run] - 1;
+            compressedData[offset++] = colours[run] >> 8;
+            compressedData[offset++] = colours[run] & 0xFF;
+        }
+    }
+
+    // Index 0 is transparent, leaving a checkerboard of holes
+    for (uint8_t i = 0; i < 16; ++i)
+    {
+        indexedPalette[i] = SCREEN_COLOUR((uint16_t)(i * 0x1111));
+    }
+    for (uint16_t i = 0; i < INDEXED_SIZE * INDEXED_SIZE; ++i)
+    {
+        uint8_t x = i % INDEXED_SIZE;
+        uint8_t y = i / INDEXED_SIZE;
+        uint8_t index = ((x / 5) + (y / 5)) % 2 ? 0 : 1 + ((x + y) % 15);
+
+        indexedData[i / 2] |= (i % 2) ? index : index << 4;
+    }
+}
+
+static bool drawText(TFT_t* screen)
+{
+    bool drawn = fillEntireBufferWithColour(screen, SCREEN_COLOUR(WHITE)) && sendEntireBuffer(screen);
+
+    for (uint8_t r = 0; r < 3; ++r)
+    {
+        drawn &= writeText(screen, "0123", 2, true, &testFont, 120, 100, SCREEN_COLOUR(BLACK));
+        drawn &= fillBufferAreaWithColour(screen, 0, 200, 240, 240, SCREEN_COLOUR(BLACK));
+        drawn &= writeText(screen, "4567", 2, false, &testFont, 120, 210, SCREEN_COLOUR(RED));
+        drawn &= writeText(screen, "98", 1, true, &testFont, 60, 20, SCREEN_COLOUR(GREEN));
+        drawn &= frameArea(screen, 10, 250, 200, 300, 3, SCREEN_COLOUR(BLUE), SCREEN_COLOUR(YELLOW));
+        drawn &= writeText(screen, "123", 0, true, &testFont, 100, 270, SCREEN_COLOUR(DARKGREY));
+    }
+    return drawn && flushDirty(screen);
+}
+
+static bool drawImages(TFT_t* screen)
+{
+    bool drawn = fillBufferAreaWithImage(screen, 30, 40, &loadingBarBackground);
+
+    drawn &= fillBufferAreaWithCompressedImage(screen, 10, 130, &compressedImage);
+    drawn &= fillBufferAreaWithIndexedImage(screen, 150, 130, &indexedImage);
+    drawn &= fillBufferAreaWithIndexedImage(screen, 160, 140, &indexedImage);
+    return drawn && flushDirty(screen);
+}
+
+static bool drawWidgets(TFT_t* screen)
+{
+    static const uint32_t progress[] = { 0, 40, 75, 30, 100 };
+    static const char* labels[] = { "123", "128", "9", "1000" };
+    ProgressBar bar;
+    TextLabel label;
+    LoadingCircle circle;
+    bool drawn = fillEntireBufferWithColour(screen, SCREEN_COLOUR(WHITE));
+
+    initProgressBar(&bar, 120, 30, 160, 10, &loadingBarBackground, 0, SCREEN_COLOUR(BLACK), SCREEN_COLOUR(DARKGREY));
+    initTextLabel(&label, &testFont, 120, 60, 1, true, SCREEN_COLOUR(WHITE), SCREEN_COLOUR(BLACK));
+    initLoadingCircle(&circle, 120, 240, 40, 32, SCREEN_COLOUR(BLACK), SCREEN_COLOUR(LIGHTGREY), SCREEN_COLOUR(WHITE));
+
+    for (uint8_t i = 0; i < 5; ++i)
+    {
+        drawn &= updateProgressBar(screen, &bar, progress[i], 100);
+        drawn &= updateTextLabel(screen, &label, labels[i % 4]);
+        drawn &= updateLoadingCircle(screen, &circle, i * 50, progress[i] * 3);
+        drawn &= flushDirty(screen);
+    }
+
+    drawn &= fillBufferArc(screen, 60, 150, 30, 0, 20, 130, SCREEN_COLOUR(RED));
+    drawn &= fillBufferArc(screen, 60, 150, 30, 0, 130, 300, SCREEN_COLOUR(BLUE));
+    drawn &= fillBufferArc(screen, 180, 150, 30, 24, 300, 600, SCREEN_COLOUR(DARKGREEN));
+    drawn &= barAdjuster(screen, 120, 100, getCalibrationValue(BUTTONS));
+    return drawn && flushDirty(screen);
+}
+
+// Anything anywhere, sent every now and then. Every 20 draws start over on a cleared screen, which keeps the display
+// list of the strip renderer from filling up.
+static bool drawRandom(TFT_t* screen)
+{
+    bool drawn = true;
+
+    for (uint16_t i = 0; i < 400; ++i)
+    {
+        uint8_t kind = sceneRandom() % 4;
+        uint16_t x = sceneRandom() % 200;
+        uint16_t y = sceneRandom() % 300;
+        uint16_t width = 1 + (sceneRandom() % 120);
+        uint16_t height = 1 + (sceneRandom() % 120);
+        uint16_t colour = sceneRandom();
+        uint16_t areaColour = sceneRandom();
+
+        // SCREEN_COLOUR takes its argument twice
+        colour = SCREEN_COLOUR(colour);
+        areaColour = SCREEN_COLOUR(areaColour);
+        width = (x + width > SCREEN_WIDTH) ? SCREEN_WIDTH - x : width;
+        height = (y + height > SCREEN_HEIGHT) ? SCREEN_HEIGHT - y : height;
+
+        if (i % 20 == 0) {
+            drawn &= fillEntireBufferWithColour(screen, colour);
+        } else if (kind == 0) {
+            drawn &= fillBufferAreaWithColour(screen, x, y, x + width, y + height, colour);
+        } else if (kind == 1 && x + loadingBarBackground.width <= SCREEN_WIDTH && y + loadingBarBackground.height <= SCREEN_HEIGHT) {
+            drawn &= fillBufferAreaWithImage(screen, x, y, &loadingBarBackground);
+        } else if (kind == 2) {
+            char text[6];
+            uint8_t spacing = sceneRandom() % 3;
+            bool normalizedWidth = sceneRandom() % 2;
+
+            // Centred on x, so at least half of four digits either side
+            snprintf(text, sizeof(text), "%u", (unsigned int)(sceneRandom() % 10000));
+            drawn &= writeText(screen, text, spacing, normalizedWidth, &testFont, 30 + (x % 180), y, colour);
+        } else {
+            uint8_t thickness = 1 + (sceneRandom() % 4);
+
+            drawn &= frameArea(screen, x, y, x + width, y + height, thickness, colour, areaColour);
+        }
+
+        if (i % 7 == 0) {
+            drawn &= flushDirty(screen);
+        }
+    }
+    return drawn && flushDirty(screen);
+}
+
+static bool drawFull(TFT_t* screen)
+{
+    bool drawn = fillEntireBufferWithColour(screen, SCREEN_COLOUR(0x1234));
+
+    drawn &= frameArea(screen, 0, 0, 239, 319, 5, SCREEN_COLOUR(0xF00F), SCREEN_COLOUR(0x0FF0));
+    drawn &= sendEntireBuffer(screen);
+    drawn &= fillScreenAreaWithColour(screen, 40, 40, 200, 120, SCREEN_COLOUR(CYAN), true);
+    drawn &= waitForTransmission(screen);
+    return drawn;
+}
+
+bool drawHostScene(TFT_t* screen, void (*checkpoint)(const char* name))
+{
+    static const struct {
+        const char* name;
+        bool (*draw)(TFT_t* screen);
+    } steps[HOST_SCENE_CHECKPOINTS] = {
+        { "text", drawText },
+        { "images", drawImages },
+        { "widgets", drawWidgets },
+        { "random", drawRandom },
+        { "full", drawFull }
+    };
+
+    buildImages();
+    sceneSeed = 1;
+
+    for (uint8_t s = 0; s < HOST_SCENE_CHECKPOINTS; ++s)
+    {
+        if (!steps[s].draw(screen) || !waitForTransmission(screen)) {
+            fprintf(stderr, "Scene step %s failed\n", steps[s].name);
+            return false;
+        }
+        checkpoint(steps[s].name);
+    }
+    return true;
+}
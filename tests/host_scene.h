@@ -0,0 +1,15 @@
+#ifndef __HOST_SCENE_H__
+#define __HOST_SCENE_H__
+
+// UI sequence shared by the host tests. It goes through every drawing path of the driver, text, images, widgets and
+// fills, and calls checkpoint each time everything drawn so far has been sent, so the simulator GRAM can be checked.
+// Colours go through SCREEN_COLOUR and images are built in the order the build expects, so every build should end up
+// with the same GRAM, apart from the nearest palette colours of SCREEN_INDEXED_FRAMEBUFFER.
+
+#include <ili9341.h>
+
+#define HOST_SCENE_CHECKPOINTS 5
+
+bool drawHostScene(TFT_t* screen, void (*checkpoint)(const char* name));
+
+#endif  /* __HOST_SCENE_H__ */
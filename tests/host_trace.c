@@ -0,0 +1,192 @@
+// Checks the SPI trace recorder against the simulated controller. The host scene (see host_scene.h) is first recorded
+// from setup on, every pixel included, into a buffer large enough to never drop a record. At every checkpoint the new
+// records are replayed into a second simulator, as tools/spi_replay.c does, whose GRAM must match the live one. Then the
+// scene is drawn again into a small buffer that wraps around. Every record must be either in the two runs or counted
+// as overwritten, and the runs back to back must be whole records. The scene ends with a full screen send, which fits
+// in the buffer, so replaying the runs over the controller as it was before the second scene must again give the live
+// GRAM, which only holds when the runs come out oldest first.
+//
+// Build: gcc -std=gnu11 -O2 -pthread -Ihost -Itests/stubs -Itests -I. -o host_trace tests/host_trace.c
+//        tests/host_scene.c tests/stubs/stubs.c ili9341.c ili9341_trace.c host/*.c -DSCREEN_SPI_TRACE
+// Usage: host_trace
+
+#include <freertos/FreeRTOS.h>
+#include <ili9341_simulator.h>
+#include <ili9341_trace.h>
+#include <host_scene.h>
+#include <ili9341.h>
+#include <pinmap.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifndef SCREEN_SPI_TRACE
+#error "host_trace needs SCREEN_SPI_TRACE"
+#endif
+
+#define FULL_TRACE_SIZE (16 * 1024 * 1024)
+#define WRAPPED_TRACE_SIZE (192 * 1024)
+
+static Ili9341Simulator sim;
+static Ili9341Simulator replay;
+static TFT_t screen;
+static uint8_t fullTrace[FULL_TRACE_SIZE];
+static uint8_t wrappedTrace[WRAPPED_TRACE_SIZE];
+static uint8_t joinedTrace[WRAPPED_TRACE_SIZE];
+static uint32_t replayed = 0;          // Bytes of fullTrace already fed to replay
+static uint32_t replayedRecords = 0;
+static uint8_t failures = 0;
+
+// Feeds the whole records in trace to replay. Returns how many there were, or -1 if the last one is cut short.
+static int32_t replayTrace(const uint8_t* trace, uint32_t length)
+{
+    uint32_t offset = 0;
+    int32_t records = 0;
+
+    while (offset < length) {
+        const SpiTraceRecord* record = (const SpiTraceRecord*)&trace[offset];
+
+        if (length - offset < sizeof(SpiTraceRecord) || length - offset < spiTraceRecordLength(record)) {
+            return -1;
+        }
+        offset += spiTraceRecordLength(record);
+
+        // Every pixel is in the trace, so nothing needs making up
+        SpiTraceKind kind = (record->flags & SPI_TRACE_KIND_MASK) >> 1;
+        bool data = record->flags & SPI_TRACE_DATA;
+
+        simulatorFeed(&replay, (const uint8_t*)(record + 1), record->length, data, (SpiHostTransactionKind)kind,
+                      SCREEN_SPI_CLOCK_HZ, (uint64_t)record->timeUs * 1000);
+        ++records;
+    }
+    return records;
+}
+
+static bool compareGram(const char* name)
+{
+    uint32_t differing = 0;
+
+    for (uint16_t y = 0; y < SIMULATOR_GRAM_HEIGHT; ++y)
+    {
+        for (uint16_t x = 0; x < SIMULATOR_GRAM_WIDTH; ++x)
+        {
+            differing += (replay.gram[y][x] != sim.gram[y][x]);
+        }
+    }
+
+    if (differing > 0) {
+        printf("%-8s %u pixels differ from the replayed trace\n", name, differing);
+        return false;
+    }
+    return true;
+}
+
+// The scene waits for its transfers before every checkpoint, so the trace can be read while still recording
+static void replayCheckpoint(const char* name)
+{
+    const uint8_t* first;
+    const uint8_t* second;
+    uint32_t firstLength;
+    uint32_t secondLength;
+
+    getSpiTrace(&first, &firstLength, &second, &secondLength);
+
+    if (first != fullTrace || secondLength != 0 || firstLength < replayed) {
+        printf("%-8s the full trace has wrapped\n", name);
+        ++failures;
+        return;
+    }
+
+    int32_t records = replayTrace(&first[replayed], firstLength - replayed);
+
+    if (records < 0) {
+        printf("%-8s the trace ends in a partial record\n", name);
+        ++failures;
+        return;
+    }
+    replayed = firstLength;
+    replayedRecords += records;
+
+    if (!compareGram(name)) {
+        ++failures;
+        return;
+    }
+    printf("%-8s %u records replayed, identical\n", name, replayedRecords);
+}
+
+static void ignoreCheckpoint(const char* name)
+{
+    (void)name;
+}
+
+static bool checkFullTrace()
+{
+    simulatorInit(&replay, SCREEN_DC_PIN);
+
+    // Started before setup, so the replay sees the init table too
+    startSpiTrace(fullTrace, FULL_TRACE_SIZE, SPI_TRACE_PIXELS);
+    if (!setupScreen(&screen, NULL)) {
+        return false;
+    }
+
+    bool correct = drawHostScene(&screen, replayCheckpoint);
+    stopSpiTrace();
+
+    SpiTraceStats stats;
+    getSpiTraceStats(&stats);
+
+    printf("full     %u recorded, %u overwritten, %u too long\n", stats.recorded, stats.overwritten, stats.tooLong);
+    return correct && failures == 0 && stats.overwritten == 0 && stats.tooLong == 0 && stats.recorded == replayedRecords;
+}
+
+static bool checkWrappedTrace()
+{
+    // The controller as the second scene finds it, since the records that set it up are the first to go
+    replay = sim;
+    simulatorResetStats(&sim);
+
+    startSpiTrace(wrappedTrace, WRAPPED_TRACE_SIZE, SPI_TRACE_PIXELS);
+    bool correct = drawHostScene(&screen, ignoreCheckpoint);
+    stopSpiTrace();
+
+    const uint8_t* first;
+    const uint8_t* second;
+    uint32_t firstLength;
+    uint32_t secondLength;
+    SpiTraceStats stats;
+
+    getSpiTrace(&first, &firstLength, &second, &secondLength);
+    getSpiTraceStats(&stats);
+
+    // Written out back to back, as a trace file would be
+    memcpy(joinedTrace, first, firstLength);
+    memcpy(&joinedTrace[firstLength], second, secondLength);
+
+    int32_t records = replayTrace(joinedTrace, firstLength + secondLength);
+
+    printf("wrapped  %u recorded, %u overwritten, %i kept in runs of %u and %u bytes, %u transactions sent\n",
+           stats.recorded, stats.overwritten, records, firstLength, secondLength, sim.stats.transactions);
+
+    if (records < 0) {
+        printf("wrapped  the runs end in a partial record\n");
+        return false;
+    }
+    correct = correct && stats.recorded == sim.stats.transactions && stats.tooLong == 0;
+    correct = correct && stats.overwritten > 0 && secondLength > 0 && stats.recorded == stats.overwritten + records;
+
+    if (!compareGram("wrapped")) {
+        return false;
+    }
+    return correct;
+}
+
+int main()
+{
+    simulatorInit(&sim, SCREEN_DC_PIN);
+    simulatorAttach(&sim);
+
+    bool correct = checkFullTrace();
+    correct = correct && checkWrappedTrace();
+
+    printf("%s\n", correct ? "PASS" : "FAIL");
+    return correct ? 0 : 1;
+}
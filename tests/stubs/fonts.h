@@ -0,0 +1,38 @@
+#ifndef __FONTS_H__
+#define __FONTS_H__
+
+// Stand-in for the project's fonts, for the host tests. testFont holds the digits only, each glyph a fixed pattern of
+// coverage levels, so text renders the same on every run.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define WRITE_TEXT_BUFFER 32
+
+#define LOG_ERROR(message, ...) printf(message "\n", ##__VA_ARGS__)
+#define LOG_BLUE(message, ...) printf(message "\n", ##__VA_ARGS__)
+
+typedef struct FontxFile {
+	bool opened;
+	const char* fontName;
+	uint8_t fontHeight;
+	const uint8_t* charDataPath;		// Coverage levels, charDataWidth per row
+	uint16_t charDataWidth;
+	uint16_t numbersNormalizedWidth;
+} FontxFile;
+
+typedef struct CharInfo {
+	char ascii;
+	uint16_t xPos;
+	uint16_t width;
+	uint16_t xOffset;
+} CharInfo;
+
+extern FontxFile testFont;
+
+bool getChar(FontxFile* fx, char ascii, uint16_t* xPos, uint16_t* width, uint16_t* xOffset);
+bool openFont(FontxFile* fx);
+void initFonts();
+
+#endif  /* __FONTS_H__ */
@@ -0,0 +1,16 @@
+#ifndef __IMAGES_H__
+#define __IMAGES_H__
+
+// Stand-in for the project's images, for the host tests. The host tests fill in the pixels.
+
+#include <stdint.h>
+
+struct Image {
+	uint16_t width;
+	uint16_t height;
+	const uint16_t* data;
+};
+
+extern struct Image loadingBarBackground;
+
+#endif  /* __IMAGES_H__ */
@@ -0,0 +1,11 @@
+#ifndef __PINMAP_H__
+#define __PINMAP_H__
+
+// Stand-in for the project's pin map, for the host tests
+
+#define SCREEN_CS_PIN 5
+#define SCREEN_RESET_PIN 4
+#define SCREEN_DC_PIN 2
+#define SLEEP_PIN 15
+
+#endif  /* __PINMAP_H__ */
@@ -0,0 +1,12 @@
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+// Stand-in for the project's settings, for the host tests
+
+#include <stdint.h>
+
+#define BUTTONS 0
+
+intptr_t getCalibrationValue(int setting);
+
+#endif  /* __SETTINGS_H__ */
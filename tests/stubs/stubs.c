@@ -0,0 +1,48 @@
+#include <images.h>
+#include <fonts.h>
+#include <settings.h>
+
+#define TEST_FONT_HEIGHT 12
+#define TEST_FONT_GLYPH_WIDTH 8
+#define TEST_FONT_OFFSET 18                 // Columns before the first glyph, see FONT_MYSTERIOUS_OFFSET in ili9341.c
+#define TEST_FONT_DATA_WIDTH (TEST_FONT_OFFSET + (10 * TEST_FONT_GLYPH_WIDTH) + TEST_FONT_GLYPH_WIDTH)
+
+static uint16_t loadingBarBackgroundData[170 * 18];
+struct Image loadingBarBackground = { 170, 18, loadingBarBackgroundData };
+
+static uint8_t testFontData[TEST_FONT_HEIGHT * TEST_FONT_DATA_WIDTH];
+FontxFile testFont = { false, "test", TEST_FONT_HEIGHT, testFontData, TEST_FONT_DATA_WIDTH, 10 };
+
+// Digits only, narrower by one pixel for every third digit so normalized width has something to do
+bool getChar(FontxFile* fx, char ascii, uint16_t* xPos, uint16_t* width, uint16_t* xOffset)
+{
+    uint8_t digit = (ascii >= '0' && ascii <= '9') ? ascii - '0' : 0;
+
+    *xPos = digit * TEST_FONT_GLYPH_WIDTH;
+    *width = TEST_FONT_GLYPH_WIDTH - (digit % 3);
+    *xOffset = 0;
+    return true;
+}
+
+// Fully covered, empty and partly covered pixels in a fixed pattern
+bool openFont(FontxFile* fx)
+{
+    for (uint16_t h = 0; h < TEST_FONT_HEIGHT; ++h)
+    {
+        for (uint16_t w = 0; w < TEST_FONT_DATA_WIDTH; ++w)
+        {
+            testFontData[(h * TEST_FONT_DATA_WIDTH) + w] = ((h * 37) + (w * 11)) % 5 == 0 ? 255 : ((h * 13) + (w * 7)) % 256;
+        }
+    }
+    fx->opened = true;
+    return true;
+}
+
+void initFonts()
+{
+}
+
+intptr_t getCalibrationValue(int setting)
+{
+    return 3;
+}
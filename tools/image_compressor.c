@@ -0,0 +1,304 @@
+// Converts a binary PPM (P6) image into a CompressedImage C source file, or with --indexed into an IndexedImage using
+// the fewest bits per pixel that hold its colours. See ili9341_image.h for both formats. --raw writes an uncompressed
+// struct Image in wire order, for builds with SCREEN_WIRE_ORDER.
+//
+// Build: gcc -I. -o image_compressor tools/image_compressor.c
+// Usage: image_compressor [--indexed | --raw] input.ppm name > name.c
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ili9341_image.h>
+
+// Input
+// ------
+
+static bool skipPpmWhitespace(FILE* file)
+{
+    int c;
+
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '#') {
+            while ((c = fgetc(file)) != EOF && c != '\n');
+        } else if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            ungetc(c, file);
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint16_t* readPpm(const char* path, uint16_t* width, uint16_t* height)
+{
+    FILE* file = fopen(path, "rb");
+    unsigned int w, h, maxValue;
+
+    if (file == NULL) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return NULL;
+    }
+
+    if (fgetc(file) != 'P' || fgetc(file) != '6' ||
+        !skipPpmWhitespace(file) || fscanf(file, "%u", &w) != 1 ||
+        !skipPpmWhitespace(file) || fscanf(file, "%u", &h) != 1 ||
+        !skipPpmWhitespace(file) || fscanf(file, "%u", &maxValue) != 1 || maxValue != 255 ||
+        w == 0 || h == 0 || w > 0xFFFF || h > 0xFFFF) {
+        fprintf(stderr, "%s is not an 8 bit binary PPM\n", path);
+        fclose(file);
+        return NULL;
+    }
+    fgetc(file);
+
+    uint16_t* pixels = malloc((size_t)w * h * sizeof(uint16_t));
+
+    for (size_t i = 0; i < (size_t)w * h; ++i)
+    {
+        int r = fgetc(file);
+        int g = fgetc(file);
+        int b = fgetc(file);
+
+        if (b == EOF) {
+            fprintf(stderr, "%s is truncated\n", path);
+            free(pixels);
+            fclose(file);
+            return NULL;
+        }
+        pixels[i] = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+    fclose(file);
+    *width = w;
+    *height = h;
+    return pixels;
+}
+
+// Encoding
+// ---------
+
+static uint8_t* output;
+static size_t outputLength = 0;
+static size_t outputSize = 0;
+
+static void emitByte(uint8_t byte)
+{
+    if (outputLength == outputSize) {
+        outputSize = outputSize ? outputSize * 2 : 4096;
+        output = realloc(output, outputSize);
+    }
+    output[outputLength++] = byte;
+}
+
+static void emitPixel(uint16_t colour)
+{
+    emitByte(colour >> 8);
+    emitByte(colour & 0xFF);
+}
+
+static void emitLiteral(const uint16_t* pixels, uint16_t count)
+{
+    emitByte(COMPRESSED_IMAGE_LITERAL | (count - 1));
+    for (uint16_t i = 0; i < count; ++i)
+    {
+        emitPixel(pixels[i]);
+    }
+}
+
+// A run of two only pays off when it does not split a literal
+static void encodeRow(const uint16_t* row, uint16_t width)
+{
+    uint16_t literalStart = 0;
+    uint16_t literalLength = 0;
+    uint16_t x = 0;
+
+    while (x < width) {
+        uint16_t run = 1;
+
+        while (x + run < width && run < COMPRESSED_IMAGE_MAX_PACKET && row[x + run] == row[x]) {
+            ++run;
+        }
+
+        if (run >= 3 || (run == 2 && literalLength == 0)) {
+            if (literalLength > 0) {
+                emitLiteral(&row[literalStart], literalLength);
+                literalLength = 0;
+            }
+            emitByte(run - 1);
+            emitPixel(row[x]);
+            x += run;
+        } else {
+            if (literalLength == 0) {
+                literalStart = x;
+            }
+            ++literalLength;
+            ++x;
+
+            if (literalLength == COMPRESSED_IMAGE_MAX_PACKET) {
+                emitLiteral(&row[literalStart], literalLength);
+                literalLength = 0;
+            }
+        }
+    }
+
+    if (literalLength > 0) {
+        emitLiteral(&row[literalStart], literalLength);
+    }
+}
+
+// Output
+// -------
+
+static void printBytes(const char* name, const uint8_t* bytes, size_t length)
+{
+    printf("static const uint8_t %sData[%zu] = {", name, length);
+    for (size_t i = 0; i < length; ++i)
+    {
+        printf("%s0x%02X", (i % 16) ? ", " : (i ? ",\n    " : "\n    "), bytes[i]);
+    }
+    printf("\n};\n\n");
+}
+
+static int writeRaw(const char* path, const char* name, const uint16_t* pixels, uint16_t width, uint16_t height)
+{
+    printf("// Generated by image_compressor from %s, for builds with SCREEN_WIRE_ORDER\n\n", path);
+    printf("#include <freertos/FreeRTOS.h>\n#include <images.h>\n\n");
+
+    printf("static const uint16_t %sData[%zu] = {", name, (size_t)width * height);
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        printf("%s0x%04X", (i % 12) ? ", " : (i ? ",\n    " : "\n    "), (uint16_t)((pixels[i] >> 8) | (pixels[i] << 8)));
+    }
+    printf("\n};\n\n");
+
+    printf("struct Image %s = { .width = %u, .height = %u, .data = %sData };\n", name, width, height, name);
+    return 0;
+}
+
+static int writeIndexed(const char* path, const char* name, const uint16_t* pixels, uint16_t width, uint16_t height)
+{
+    uint16_t palette[256];
+    uint16_t colours = 0;
+    uint8_t bitsPerPixel = 1;
+
+    for (size_t i = 0; i < (size_t)width * height; ++i)
+    {
+        uint16_t c = 0;
+
+        while (c < colours && palette[c] != pixels[i]) {
+            ++c;
+        }
+        if (c == colours) {
+            if (colours == 256) {
+                fprintf(stderr, "%s has more than 256 colours\n", path);
+                return 1;
+            }
+            palette[colours++] = pixels[i];
+        }
+    }
+
+    while ((1 << bitsPerPixel) < colours) {
+        bitsPerPixel *= 2;
+    }
+
+    uint32_t stride = ((uint32_t)width * bitsPerPixel + 7) / 8;
+    uint8_t* data = calloc((size_t)stride * height, 1);
+
+    for (uint16_t y = 0; y < height; ++y)
+    {
+        for (uint16_t x = 0; x < width; ++x)
+        {
+            uint16_t c = 0;
+            uint32_t bit = (uint32_t)x * bitsPerPixel;
+
+            while (palette[c] != pixels[(size_t)y * width + x]) {
+                ++c;
+            }
+            data[(y * stride) + (bit >> 3)] |= c << (8 - bitsPerPixel - (bit & 7));
+        }
+    }
+
+    printf("// Generated by image_compressor from %s\n\n", path);
+    printf("#include <freertos/FreeRTOS.h>\n#include <ili9341_image.h>\n\n");
+
+    // Palette goes out in wire order, so the blit never swaps bytes
+    printf("static const uint16_t %sPalette[%u] = {", name, colours);
+    for (uint16_t i = 0; i < colours; ++i)
+    {
+        printf("%s0x%04X", (i % 8) ? ", " : (i ? ",\n    " : "\n    "), (uint16_t)((palette[i] >> 8) | (palette[i] << 8)));
+    }
+    printf("\n};\n\n");
+
+    printBytes(name, data, (size_t)stride * height);
+
+    printf("const IndexedImage %s = { %u, %u, %u, INDEXED_IMAGE_OPAQUE, %sPalette, %sData };\n", name, width, height, bitsPerPixel, name, name);
+
+    size_t rawSize = (size_t)width * height * 2;
+    size_t indexedSize = ((size_t)stride * height) + (colours * 2);
+
+    fprintf(stderr, "%s: %ux%u, %u colours at %u bpp, %zu bytes raw, %zu bytes indexed (%.1fx)\n", name, width, height, colours, bitsPerPixel, rawSize, indexedSize, (double)rawSize / indexedSize);
+
+    free(data);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint16_t width, height;
+    bool indexed = (argc == 4 && strcmp(argv[1], "--indexed") == 0);
+    bool raw = (argc == 4 && strcmp(argv[1], "--raw") == 0);
+
+    if (argc != 3 && !indexed && !raw) {
+        fprintf(stderr, "Usage: %s [--indexed | --raw] input.ppm name > name.c\n", argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[argc - 2];
+    const char* name = argv[argc - 1];
+    uint16_t* pixels = readPpm(path, &width, &height);
+
+    if (pixels == NULL) {
+        return 1;
+    }
+
+    if (indexed || raw) {
+        int result = indexed ? writeIndexed(path, name, pixels, width, height) : writeRaw(path, name, pixels, width, height);
+        free(pixels);
+        return result;
+    }
+
+    uint16_t indexCount = (height + COMPRESSED_IMAGE_INDEX_ROWS - 1) / COMPRESSED_IMAGE_INDEX_ROWS;
+    uint32_t* rowIndex = malloc(indexCount * sizeof(uint32_t));
+
+    for (uint16_t y = 0; y < height; ++y)
+    {
+        if (y % COMPRESSED_IMAGE_INDEX_ROWS == 0) {
+            rowIndex[y / COMPRESSED_IMAGE_INDEX_ROWS] = outputLength;
+        }
+        encodeRow(&pixels[(size_t)y * width], width);
+    }
+
+    printf("// Generated by image_compressor from %s\n\n", path);
+    printf("#include <freertos/FreeRTOS.h>\n#include <ili9341_image.h>\n\n");
+
+    printf("static const uint32_t %sRowIndex[%u] = {", name, indexCount);
+    for (uint16_t i = 0; i < indexCount; ++i)
+    {
+        printf("%s%u", (i % 12) ? ", " : (i ? ",\n    " : "\n    "), rowIndex[i]);
+    }
+    printf("\n};\n\n");
+
+    printBytes(name, output, outputLength);
+
+    printf("const CompressedImage %s = { %u, %u, %u, %sRowIndex, %sData };\n", name, width, height, COMPRESSED_IMAGE_INDEX_ROWS, name, name);
+
+    size_t rawSize = (size_t)width * height * 2;
+    size_t compressedSize = outputLength + (indexCount * sizeof(uint32_t));
+
+    fprintf(stderr, "%s: %ux%u, %zu bytes raw, %zu bytes compressed (%.1fx)\n", name, width, height, rawSize, compressedSize, (double)rawSize / compressedSize);
+
+    free(rowIndex);
+    free(pixels);
+    free(output);
+    return 0;
+}
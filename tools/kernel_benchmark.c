@@ -0,0 +1,152 @@
+// Host benchmark for the span kernels in ili9341_kernels.h. Checks every kernel against a plain per-pixel loop, then
+// reports Mpixel/s per kernel and span width, starting both at a word aligned pixel and one pixel past it.
+//
+// Build: gcc -O2 -I. -o kernel_benchmark tools/kernel_benchmark.c
+// Usage: kernel_benchmark [pixels per measurement, default 50000000]
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <ili9341_kernels.h>
+
+#define BUFFER_PIXELS (240 * 320 + 2)
+
+static uint16_t destination[BUFFER_PIXELS] __attribute__((aligned(8)));
+static uint16_t reference[BUFFER_PIXELS] __attribute__((aligned(8)));
+static uint16_t source[BUFFER_PIXELS] __attribute__((aligned(8)));
+
+static const uint32_t widths[] = { 1, 2, 3, 7, 16, 33, 64, 240, 240 * 8, 240 * 320 };
+
+typedef enum Kernel {
+    KERNEL_FILL = 0,
+    KERNEL_FILL_PATTERN,
+    KERNEL_COPY,
+    KERNEL_COPY_SWAP,
+    KERNEL_COUNT
+} Kernel;
+
+static const char* kernelNames[KERNEL_COUNT] = { "spanFill", "spanFillPattern", "spanCopy", "spanCopySwap" };
+
+static void runKernel(Kernel kernel, uint16_t* to, const uint16_t* from, uint32_t count)
+{
+    switch (kernel) {
+        case KERNEL_FILL:
+            spanFill(to, 0xA55A, count);
+            break;
+        case KERNEL_FILL_PATTERN:
+            spanFillPattern(to, 0x1234ABCD, count);
+            break;
+        case KERNEL_COPY:
+            spanCopy(to, from, count);
+            break;
+        case KERNEL_COPY_SWAP:
+            spanCopySwap(to, from, count);
+            break;
+        default:
+            break;
+    }
+}
+
+// What each kernel must produce, one pixel at a time
+static void runReference(Kernel kernel, uint16_t* to, const uint16_t* from, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        switch (kernel) {
+            case KERNEL_FILL:
+                to[i] = 0xA55A;
+                break;
+            case KERNEL_FILL_PATTERN:
+                to[i] = (i % 2) ? 0x1234 : 0xABCD;
+                break;
+            case KERNEL_COPY:
+                to[i] = from[i];
+                break;
+            case KERNEL_COPY_SWAP:
+                to[i] = (uint16_t)((from[i] >> 8) | (from[i] << 8));
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Every width and alignment, with a guard pixel either side that must stay untouched
+static bool verifyKernel(Kernel kernel)
+{
+    for (uint32_t count = 0; count < 70; ++count)
+    {
+        for (uint8_t destinationOffset = 1; destinationOffset <= 2; ++destinationOffset)
+        {
+            for (uint8_t sourceOffset = 0; sourceOffset <= 1; ++sourceOffset)
+            {
+                for (uint32_t i = 0; i < count + 4; ++i)
+                {
+                    destination[i] = reference[i] = 0xDEAD;
+                }
+
+                runKernel(kernel, destination + destinationOffset, source + sourceOffset, count);
+                runReference(kernel, reference + destinationOffset, source + sourceOffset, count);
+
+                for (uint32_t i = 0; i < count + 4; ++i)
+                {
+                    if (destination[i] != reference[i]) {
+                        fprintf(stderr, "%s wrong at pixel %u of %u (destination +%u, source +%u)\n", kernelNames[kernel], i, count, destinationOffset, sourceOffset);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static double measure(Kernel kernel, uint32_t width, uint8_t offset, uint64_t pixels)
+{
+    uint64_t repeats = pixels / width + 1;
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t r = 0; r < repeats; ++r)
+    {
+        runKernel(kernel, destination + offset, source + offset, width);
+
+        // Keeps the compiler from dropping all but the last repeat
+        __asm__ volatile("" : : "r"(destination) : "memory");
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+    return (repeats * width) / seconds / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t pixels = (argc > 1) ? strtoull(argv[1], NULL, 10) : 50000000;
+    bool correct = true;
+
+    for (uint32_t i = 0; i < BUFFER_PIXELS; ++i)
+    {
+        source[i] = (uint16_t)(i * 2654435761u >> 16);
+    }
+
+    for (Kernel k = 0; k < KERNEL_COUNT; ++k)
+    {
+        correct &= verifyKernel(k);
+    }
+    if (!correct) {
+        return 1;
+    }
+
+    printf("%-16s %8s %12s %12s   (Mpixel/s)\n", "kernel", "width", "aligned", "unaligned");
+    for (Kernel k = 0; k < KERNEL_COUNT; ++k)
+    {
+        for (uint8_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w)
+        {
+            printf("%-16s %8u %12.1f %12.1f\n", kernelNames[k], widths[w], measure(k, widths[w], 0, pixels), measure(k, widths[w], 1, pixels));
+        }
+    }
+    return 0;
+}
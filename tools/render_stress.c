@@ -0,0 +1,138 @@
+// Host stress test for the render task in ili9341_render.c. Several producer threads queue numbered calls and fills
+// as fast as they can, retrying whenever the queue is full. Checks that each producer's commands ran exactly once and
+// in the order they were queued, and that the screen ends up showing each producer's last fill. Reports commands/s
+// and the queue statistics.
+//
+// Build: gcc -O2 -pthread -Ihost -Itests/stubs -I. -o render_stress tools/render_stress.c ili9341.c ili9341_render.c
+//        ili9341_trace.c host/*.c tests/stubs/stubs.c
+// Usage: render_stress [producers, default 4] [commands per producer, default 20000]
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <ili9341_simulator.h>
+#include <ili9341_render.h>
+#include <ili9341.h>
+#include <pinmap.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define MAX_PRODUCERS 8
+#define STRIPE_HEIGHT (SCREEN_HEIGHT / MAX_PRODUCERS)
+
+typedef struct Producer {
+    pthread_t thread;
+    uint8_t id;
+    uint32_t commands;
+    uint32_t retries;
+    uint32_t expected;          // Only touched by the render task
+    uint32_t outOfOrder;
+    uint16_t lastColour;
+} Producer;
+
+// A call carries its producer and number packed into the argument
+static Producer producers[MAX_PRODUCERS];
+static atomic_uint calls;
+static TFT_t screen;
+
+static void checkCall(void* arg)
+{
+    uintptr_t packed = (uintptr_t)arg;
+    Producer* producer = &producers[packed >> 24];
+    uint32_t number = packed & 0xFFFFFF;
+
+    if (number != producer->expected) {
+        ++producer->outOfOrder;
+    }
+    producer->expected = number + 1;
+    atomic_fetch_add_explicit(&calls, 1, memory_order_relaxed);
+}
+
+static void* produce(void* parameters)
+{
+    Producer* producer = parameters;
+    uint16_t y1 = producer->id * STRIPE_HEIGHT;
+    unsigned int seed = producer->id + 1;
+
+    for (uint32_t i = 0; i < producer->commands; ++i)
+    {
+        void* arg = (void*)(((uintptr_t)producer->id << 24) | i);
+
+        while (!renderCall(checkCall, arg)) {
+            ++producer->retries;
+            sched_yield();
+        }
+
+        if (i % 8 == 0) {
+            uint16_t colour = (uint16_t)rand_r(&seed);
+
+            while (!renderFill(&screen, 0, y1, SCREEN_WIDTH, y1 + STRIPE_HEIGHT, colour)) {
+                ++producer->retries;
+                sched_yield();
+            }
+            producer->lastColour = colour;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    uint8_t producerCount = (argc > 1) ? atoi(argv[1]) : 4;
+    uint32_t commands = (argc > 2) ? strtoul(argv[2], NULL, 10) : 20000;
+    static Ili9341Simulator sim;
+    struct timespec start, end;
+
+    if (producerCount < 1 || producerCount > MAX_PRODUCERS || commands >= (1 << 24)) {
+        fprintf(stderr, "Usage: %s [producers 1-%u] [commands per producer]\n", argv[0], MAX_PRODUCERS);
+        return 1;
+    }
+
+    simulatorInit(&sim, SCREEN_DC_PIN);
+    simulatorAttach(&sim);
+    setupScreen(&screen, NULL);
+    startRenderTask();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint8_t p = 0; p < producerCount; ++p)
+    {
+        producers[p].id = p;
+        producers[p].commands = commands;
+        pthread_create(&producers[p].thread, NULL, produce, &producers[p]);
+    }
+    for (uint8_t p = 0; p < producerCount; ++p)
+    {
+        pthread_join(producers[p].thread, NULL);
+    }
+    waitForRenderQueue(portMAX_DELAY);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    bool correct = atomic_load(&calls) == producerCount * commands;
+
+    for (uint8_t p = 0; p < producerCount; ++p)
+    {
+        uint32_t wrongPixels = 0;
+
+        for (uint16_t y = p * STRIPE_HEIGHT; y < (p + 1) * STRIPE_HEIGHT; ++y)
+        {
+            for (uint16_t x = 0; x < SCREEN_WIDTH; ++x)
+            {
+                wrongPixels += sim.gram[y][x] != producers[p].lastColour;
+            }
+        }
+
+        printf("producer %u: %u calls out of order, %u retries, %u wrong pixels\n", p, producers[p].outOfOrder, producers[p].retries, wrongPixels);
+        correct &= producers[p].outOfOrder == 0 && producers[p].expected == commands && wrongPixels == 0;
+    }
+
+    RenderQueueStats stats;
+    getRenderQueueStats(&stats);
+
+    double seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+    printf("%u calls run of %u, %.0f commands/s\n", atomic_load(&calls), producerCount * commands, stats.queued / seconds);
+    printf("queued %u, dropped %u, drawn %u, coalesced %u, frames %u, most in one frame %u\n", stats.queued, stats.dropped, stats.drawn, stats.coalesced, stats.frames, stats.maxDepth);
+    printf("%s\n", correct ? "PASS" : "FAIL");
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Replays an SPI trace recorded with SCREEN_SPI_TRACE (see ili9341_trace.h) into the host simulator, offline. Reports
+// bus utilisation, bandwidth and the idle gaps between transactions on the modelled bus, then the redundant traffic:
+// address windows set to what they already were and pixels written with the colour they already had. Pixels recorded
+// as hashes are replayed as a flat colour made from the hash, so a repeated write still shows up as redundant; pixels
+// recorded by length only come out grey and say nothing about redundancy.
+//
+// Build: gcc -O2 -pthread -Ihost -I. -o spi_replay tools/spi_replay.c host/*.c
+// Usage: spi_replay trace.bin [--screen cs pin, default the first in the trace] [--clock Hz, default 40000000]
+//        [--gap us, default 1000] [--ppm out.ppm]
+
+#include <freertos/FreeRTOS.h>
+#include <ili9341_simulator.h>
+#include <ili9341_trace.h>
+#include <ili9341.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define UNTRACED_GREY 0x8410
+
+// MADCTL bits
+#define MADCTL_MY 0x80
+#define MADCTL_MX 0x40
+#define MADCTL_MV 0x20
+
+typedef struct ReplayStats {
+    uint32_t records;
+    uint32_t skipped;               // Other screens
+    uint32_t kinds[3];
+    uint64_t commandBytes;
+    uint64_t pixelBytes;
+    uint64_t spanNs;                // First record handed over to the bus going idle after the last
+    uint64_t busyNs;
+    uint64_t idleNs;
+    uint64_t longestGapNs;
+    uint64_t longestGapAtNs;
+    uint32_t longGaps;              // Idle for longer than --gap
+    uint32_t redundantWindows;
+    uint64_t pixelsWritten;
+    uint64_t redundantPixels;
+} ReplayStats;
+
+static Ili9341Simulator sim;
+static uint16_t shadow[SIMULATOR_GRAM_HEIGHT][SIMULATOR_GRAM_WIDTH];
+static uint8_t synthetic[65536];
+
+static uint8_t* readFile(const char* path, size_t* length)
+{
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    uint8_t* bytes = malloc(*length ? *length : 1);
+    if (bytes != NULL && fread(bytes, 1, *length, file) != *length) {
+        free(bytes);
+        bytes = NULL;
+    }
+    fclose(file);
+    return bytes;
+}
+
+// GRAM corner of window corner (column, page), mapped the way the simulator maps writes
+static void mapToGram(uint16_t column, uint16_t page, uint16_t* x, uint16_t* y)
+{
+    *x = column;
+    *y = page;
+
+    if (sim.madctl & MADCTL_MV) {
+        *x = page;
+        *y = column;
+    }
+    if (sim.madctl & MADCTL_MX) {
+        *x = SIMULATOR_GRAM_WIDTH - 1 - *x;
+    }
+    if (sim.madctl & MADCTL_MY) {
+        *y = SIMULATOR_GRAM_HEIGHT - 1 - *y;
+    }
+}
+
+// Pixels inside the current window that a memory write changed, bringing the shadow copy up to date as it goes
+static uint64_t changedPixels()
+{
+    uint16_t x1, y1, x2, y2;
+    uint64_t changed = 0;
+
+    mapToGram(sim.columnStart, sim.pageStart, &x1, &y1);
+    mapToGram(sim.columnEnd, sim.pageEnd, &x2, &y2);
+    if (x1 > x2) {
+        uint16_t swap = x1;
+        x1 = x2;
+        x2 = swap;
+    }
+    if (y1 > y2) {
+        uint16_t swap = y1;
+        y1 = y2;
+        y2 = swap;
+    }
+    x2 = (x2 < SIMULATOR_GRAM_WIDTH) ? x2 : SIMULATOR_GRAM_WIDTH - 1;
+    y2 = (y2 < SIMULATOR_GRAM_HEIGHT) ? y2 : SIMULATOR_GRAM_HEIGHT - 1;
+
+    for (uint16_t y = y1; y <= y2; ++y)
+    {
+        for (uint16_t x = x1; x <= x2; ++x)
+        {
+            if (shadow[y][x] != sim.gram[y][x]) {
+                shadow[y][x] = sim.gram[y][x];
+                ++changed;
+            }
+        }
+    }
+    return changed;
+}
+
+// Bytes standing in for a transaction whose pixels were not recorded
+static const uint8_t* syntheticBytes(const SpiTraceRecord* record, const uint8_t* after)
+{
+    uint16_t colour = UNTRACED_GREY;
+
+    if (record->flags & SPI_TRACE_HASH) {
+        uint32_t hash;
+        memcpy(&hash, after, sizeof(hash));
+        colour = (uint16_t)(hash ^ (hash >> 16));
+    }
+
+    for (uint32_t i = 0; i + 1 < record->length; i += 2)
+    {
+        synthetic[i] = colour >> 8;
+        synthetic[i + 1] = colour & 0xFF;
+    }
+    return synthetic;
+}
+
+static bool replay(const uint8_t* trace, size_t length, int screen, int clockSpeedHz, uint64_t gapNs, ReplayStats* stats)
+{
+    uint64_t recordNs = 0;
+    uint64_t busFreeNs = 0;
+    uint32_t lastUs = 0;
+    bool timed = false;
+    bool started = false;
+
+    for (size_t offset = 0; offset < length;)
+    {
+        const SpiTraceRecord* record = (const SpiTraceRecord*)(trace + offset);
+
+        if (length - offset < sizeof(SpiTraceRecord) || length - offset < spiTraceRecordLength(record)) {
+            fprintf(stderr, "Trace cut short at byte %zu\n", offset);
+            return false;
+        }
+        offset += spiTraceRecordLength(record);
+
+        // Times are 32-bit microseconds, so only the step from the last record is meaningful
+        if (timed) {
+            recordNs += (uint64_t)(uint32_t)(record->timeUs - lastUs) * 1000;
+        }
+        lastUs = record->timeUs;
+        timed = true;
+
+        if (screen < 0) {
+            screen = record->screen;
+        }
+        if (record->screen != screen) {
+            ++stats->skipped;
+            continue;
+        }
+
+        SpiTraceKind kind = (record->flags & SPI_TRACE_KIND_MASK) >> 1;
+        bool data = record->flags & SPI_TRACE_DATA;
+        const uint8_t* after = (const uint8_t*)(record + 1);
+        const uint8_t* bytes = (record->flags & SPI_TRACE_PAYLOAD) ? after : syntheticBytes(record, after);
+        bool pixels = data && (sim.command == ILI9341_WRITE_RAM || sim.command == ILI9341_WMC);
+        bool window = data && (sim.command == ILI9341_COLUMN_ADDR || sim.command == ILI9341_PAGE_ADDR) && record->length == 4;
+        uint16_t windowBefore[4] = { sim.columnStart, sim.columnEnd, sim.pageStart, sim.pageEnd };
+        uint64_t writtenBefore = sim.stats.pixelsWritten;
+
+        if (kind > SPI_TRACE_POLLING) {
+            fprintf(stderr, "Bad record at byte %zu\n", offset);
+            return false;
+        }
+
+        // A transaction goes out when it was handed over, or once the ones before it are done
+        uint64_t startNs = (recordNs > busFreeNs) ? recordNs : busFreeNs;
+        uint64_t busNs = sim.transactionOverheadNs[kind] + ((uint64_t)record->length * 8000000000ULL) / clockSpeedHz;
+
+        if (started && startNs > busFreeNs) {
+            uint64_t gap = startNs - busFreeNs;
+
+            stats->idleNs += gap;
+            if (gap > stats->longestGapNs) {
+                stats->longestGapNs = gap;
+                stats->longestGapAtNs = busFreeNs;
+            }
+            stats->longGaps += gap > gapNs;
+        }
+        started = true;
+        busFreeNs = startNs + busNs;
+        stats->busyNs += busNs;
+
+        simulatorFeed(&sim, bytes, record->length, data, (SpiHostTransactionKind)kind, clockSpeedHz, startNs);
+
+        ++stats->records;
+        ++stats->kinds[kind];
+        if (pixels) {
+            uint64_t written = sim.stats.pixelsWritten - writtenBefore;
+            uint64_t changed = changedPixels();
+
+            stats->pixelBytes += record->length;
+            stats->pixelsWritten += written;
+            stats->redundantPixels += (written > changed) ? written - changed : 0;
+        } else {
+            stats->commandBytes += record->length;
+        }
+        if (window) {
+            uint16_t windowAfter[4] = { sim.columnStart, sim.columnEnd, sim.pageStart, sim.pageEnd };
+            stats->redundantWindows += memcmp(windowBefore, windowAfter, sizeof(windowBefore)) == 0;
+        }
+    }
+
+    stats->spanNs = busFreeNs;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const char* tracePath = NULL;
+    const char* ppmPath = NULL;
+    int screen = -1;
+    int clockSpeedHz = 40000000;
+    uint64_t gapNs = 1000000;
+    ReplayStats stats = { 0 };
+    size_t length;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--screen") == 0 && i + 1 < argc) {
+            screen = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            clockSpeedHz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc) {
+            gapNs = strtoull(argv[++i], NULL, 10) * 1000;
+        } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppmPath = argv[++i];
+        } else if (tracePath == NULL && argv[i][0] != '-') {
+            tracePath = argv[i];
+        } else {
+            tracePath = NULL;
+            break;
+        }
+    }
+
+    if (tracePath == NULL || clockSpeedHz <= 0) {
+        fprintf(stderr, "Usage: %s trace.bin [--screen cs pin] [--clock Hz] [--gap us] [--ppm out.ppm]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t* trace = readFile(tracePath, &length);
+    if (trace == NULL) {
+        fprintf(stderr, "Could not read %s\n", tracePath);
+        return 1;
+    }
+
+    simulatorInit(&sim, -1);
+    memcpy(shadow, sim.gram, sizeof(shadow));
+
+    bool complete = replay(trace, length, screen, clockSpeedHz, gapNs, &stats);
+    double seconds = stats.spanNs / 1e9;
+
+    printf("%u transactions (%u queued, %u blocking, %u polling), %u for other screens skipped\n", stats.records, stats.kinds[SPI_TRACE_QUEUED], stats.kinds[SPI_TRACE_BLOCKING], stats.kinds[SPI_TRACE_POLLING], stats.skipped);
+    printf("%llu command and parameter bytes, %llu pixel bytes over %.3f ms\n", (unsigned long long)stats.commandBytes, (unsigned long long)stats.pixelBytes, seconds * 1e3);
+    printf("bus busy %.1f%%, %.2f MB/s\n", seconds > 0 ? 100.0 * stats.busyNs / stats.spanNs : 0.0, seconds > 0 ? (stats.commandBytes + stats.pixelBytes) / seconds / 1e6 : 0.0);
+    printf("idle %.3f ms, %u gaps over %llu us, longest %.3f ms at %.3f ms\n", stats.idleNs / 1e6, stats.longGaps, (unsigned long long)(gapNs / 1000), stats.longestGapNs / 1e6, stats.longestGapAtNs / 1e6);
+    printf("%u of %u address sets redundant\n", stats.redundantWindows, sim.stats.columnAddressSets + sim.stats.pageAddressSets);
+    printf("%llu of %llu pixels written unchanged (%.1f%%), %u torn memory writes\n", (unsigned long long)stats.redundantPixels, (unsigned long long)stats.pixelsWritten, stats.pixelsWritten ? 100.0 * stats.redundantPixels / stats.pixelsWritten : 0.0, sim.stats.tornMemoryWrites);
+
+    if (ppmPath != NULL && !simulatorDumpPpm(&sim, ppmPath, true)) {
+        fprintf(stderr, "Could not write %s\n", ppmPath);
+        complete = false;
+    }
+
+    free(trace);
+    return complete ? 0 : 1;
+}